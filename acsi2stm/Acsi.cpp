@@ -17,8 +17,11 @@
 
 #include "Acsi.h"
 
+#include "Counters.h"
 #include "DmaPort.h"
 #include "FlashFirmware.h"
+#include "Profile.h"
+#include "Trace.h"
 
 #if ACSI_STRICT && ACSI_READONLY > 1
 #error ACSI_READONLY == 2 and strict mode are incompatible
@@ -61,6 +64,18 @@ void Acsi::process(uint8_t cmd) {
     // Slot disabled: unplug the device completely
     return;
 
+#if ACSI_TRACE || ACSI_COUNTERS
+  uint32_t start = cycles();
+  processCommand(cmd);
+  uint32_t duration = cycles() - start;
+  Trace::acsi(blockDev.slot, lastErr, duration, cmdBuf, cmdLen);
+  Counters::acsi(cmdBuf[0], duration);
+#else
+  processCommand(cmd);
+#endif
+}
+
+void Acsi::processCommand(uint8_t cmd) {
   readCmdBuf(cmd);
 
 #if ACSI_VERBOSE
@@ -70,8 +85,16 @@ void Acsi::process(uint8_t cmd) {
   dbg(" ");
 #endif
 
+#if ACSI_NULL_LUN
+  if(getLun() == ACSI_NULL_LUN && processNullLun())
+    return;
+#endif
+
   // Command preprocessing
   switch(cmdBuf[0]) {
+#if ACSI_FORMAT_UNIT
+  case 0x04: // Format unit
+#endif
   case 0x08: // Read block
   case 0x0a: // Write block
   case 0x0b: // Seek
@@ -162,6 +185,24 @@ void Acsi::process(uint8_t cmd) {
 
     commandStatus(ERR_OK);
     return;
+#if ACSI_FORMAT_UNIT
+  case 0x04: // Format unit
+    if(cmdBuf[1] & 0x10) {
+      // Defect lists are not supported
+      verbose("Format data ");
+      commandStatus(ERR_INVARG);
+      return;
+    }
+    if(!blockDev->isWritable()) {
+      commandStatus(ERR_WRITEPROT);
+      return;
+    }
+
+    // Erase all blocks so the card is as fast as new
+    dbg("Format ");
+    commandStatus(blockDev->erase() ? ERR_OK : ERR_WRITEERR);
+    return;
+#endif
   case 0x08: // Read block
     // Compute the block number
     block = (((int)cmdBuf[1] & 0x1f) << 16) | (((int)cmdBuf[2]) << 8) | (cmdBuf[3]);
@@ -294,6 +335,51 @@ void Acsi::process(uint8_t cmd) {
       return;
     }
 #endif
+#if ACSI_PROFILE
+    if(memcmp(&cmdBuf[1], "ACSIPrfRd", 9) == 0) {
+      verbose("Profile read ");
+      memset(buf, 0, ACSI_BLOCKSIZE);
+      Profile::write(buf);
+      Profile::dump();
+      DmaPort::sendDma(buf, ACSI_BLOCKSIZE);
+      commandStatus(ERR_OK);
+      return;
+    }
+    if(memcmp(&cmdBuf[1], "ACSIPrfRs", 9) == 0) {
+      verbose("Profile reset ");
+      Profile::reset();
+      commandStatus(ERR_OK);
+      return;
+    }
+#endif
+#if ACSI_COUNTERS
+    if(memcmp(&cmdBuf[1], "ACSICntRd", 9) == 0) {
+      verbose("Counters read ");
+      memset(buf, 0, 4 * ACSI_BLOCKSIZE);
+      Counters::write(buf);
+      DmaPort::sendDma(buf, 4 * ACSI_BLOCKSIZE);
+      commandStatus(ERR_OK);
+      return;
+    }
+    if(memcmp(&cmdBuf[1], "ACSICntRs", 9) == 0) {
+      verbose("Counters reset ");
+      Counters::reset();
+      commandStatus(ERR_OK);
+      return;
+    }
+#endif
+#if ACSI_TRACE
+    if(memcmp(&cmdBuf[1], "ACSITrcRd", 9) == 0) {
+      verbose("Trace read ");
+      // Word: number of trace bytes, then trace bytes
+      int size = Trace::read(&buf[2], ACSI_BLOCKSIZE - 2);
+      buf[0] = size >> 8;
+      buf[1] = size;
+      DmaPort::sendDma(buf, ACSI_BLOCKSIZE);
+      commandStatus(ERR_OK);
+      return;
+    }
+#endif
 
     dbg("Unknown command ");
     commandStatus(ERR_OPCODE);
@@ -431,6 +517,8 @@ void Acsi::process(uint8_t cmd) {
 }
 
 void Acsi::readCmdBuf(uint8_t cmd) {
+  ACSI_PROFILE_ZONE(READ_CMD);
+
   if(cmd == 0x1f)
     // ICD extended command marker
     DmaPort::readIrq(&cmdBuf[0], 1);
@@ -440,19 +528,19 @@ void Acsi::readCmdBuf(uint8_t cmd) {
 
   if(cmdBuf[0] >= 0xa0) {
     // 12 bytes command
-    DmaPort::readIrq(&cmdBuf[1], 11);
+    DmaPort::readCmdIrq(&cmdBuf[1], 11);
     cmdLen = 12;
   } else if(cmdBuf[0] >= 0x80) {
     // 16 bytes command
-    DmaPort::readIrq(&cmdBuf[1], 15);
+    DmaPort::readCmdIrq(&cmdBuf[1], 15);
     cmdLen = 16;
   } else if(cmdBuf[0] >= 0x20) {
     // 10 bytes command
-    DmaPort::readIrq(&cmdBuf[1], 9);
+    DmaPort::readCmdIrq(&cmdBuf[1], 9);
     cmdLen = 10;
   } else {
     // 6 bytes command
-    DmaPort::readIrq(&cmdBuf[1], 5);
+    DmaPort::readCmdIrq(&cmdBuf[1], 5);
     cmdLen = 6;
   }
 }
@@ -465,6 +553,52 @@ int Acsi::getLun() {
   return cmdBuf[1] >> 5;
 }
 
+#if ACSI_NULL_LUN
+bool Acsi::processNullLun() {
+  int count;
+  switch(cmdBuf[0]) {
+  case 0x00: // Test unit ready
+    commandStatus(ERR_OK);
+    return true;
+  case 0x08: // Read block
+  case 0x0a: // Write block
+    count = cmdBuf[4];
+    break;
+  case 0x28: // Read blocks
+  case 0x2a: // Write blocks
+    count = (((int)cmdBuf[7]) << 8) | (cmdBuf[8]);
+    break;
+  default:
+    return false;
+  }
+
+  bool write = cmdBuf[0] & 0x02;
+  dbg(write ? "Null write " : "Null read ", count, " blocks ");
+
+  // Use the same transfers as SD card access, without the SD card
+  if(write)
+    DmaPort::dmaStartDelay();
+  else
+    memset(buf, 0, bufSize);
+
+  for(int s = 0; s < count;) {
+    int burst = ACSI_BLOCKS;
+    if(burst > count - s)
+      burst = count - s;
+
+    if(write)
+      DmaPort::readDma(buf, ACSI_BLOCKSIZE * burst);
+    else
+      DmaPort::sendDma(buf, ACSI_BLOCKSIZE * burst);
+
+    s += burst;
+  }
+
+  commandStatus(ERR_OK);
+  return true;
+}
+#endif
+
 void Acsi::commandStatus(ScsiErr err, uint32_t block) {
   lastErr = err;
   lastBlock = block;
@@ -501,6 +635,29 @@ Acsi::ScsiErr Acsi::processBlockRead(uint32_t block, int count) {
     return ERR_READERR;
   }
 
+#if ACSI_FAST_DMA == 6 && ACSI_BLOCKS >= 2
+  // Read the next half buffer while the other half is being sent
+  uint8_t *half = buf;
+  for(int s = 0; s < count;) {
+    int burst = ACSI_BLOCKS / 2;
+    if(burst > count - s)
+      burst = count - s;
+
+    bool success = blockDev->readData(half, burst);
+    if(s)
+      DmaPort::waitDma();
+    if(!success) {
+      dbg("Read error ");
+      blockDev->readStop();
+      return ERR_READERR;
+    }
+    DmaPort::startSendDma(half, ACSI_BLOCKSIZE * burst);
+
+    half = half == buf ? &buf[bufSize / 2] : buf;
+    s += burst;
+  }
+  DmaPort::waitDma();
+#else
   for(int s = 0; s < count;) {
     int burst = ACSI_BLOCKS;
     if(burst > count - s)
@@ -515,6 +672,7 @@ Acsi::ScsiErr Acsi::processBlockRead(uint32_t block, int count) {
 
     s += burst;
   }
+#endif
 
   blockDev->readStop();
 
@@ -542,6 +700,40 @@ Acsi::ScsiErr Acsi::processBlockWrite(uint32_t block, int count) {
     return ERR_WRITEERR;
   }
 
+#if ACSI_FAST_DMA == 6 && ACSI_BLOCKS >= 4
+  // Receive the next half buffer while the other half is being written.
+  // startReadDma needs twice the room, so each half receives a quarter of
+  // the buffer size.
+  uint8_t *half = buf;
+  int burst = ACSI_BLOCKS / 4;
+  if(burst > count)
+    burst = count;
+  if(burst)
+    DmaPort::startReadDma(half, ACSI_BLOCKSIZE * burst);
+
+  for(int s = 0; s < count;) {
+    DmaPort::waitDma();
+
+    uint8_t *nextHalf = half == buf ? &buf[bufSize / 2] : buf;
+    int nextBurst = ACSI_BLOCKS / 4;
+    if(nextBurst > count - s - burst)
+      nextBurst = count - s - burst;
+    if(nextBurst)
+      DmaPort::startReadDma(nextHalf, ACSI_BLOCKSIZE * nextBurst);
+
+    if(!blockDev->writeData(half, burst)) {
+      dbg("Write error ");
+      if(nextBurst)
+        DmaPort::waitDma();
+      blockDev->writeStop();
+      return ERR_WRITEERR;
+    }
+
+    s += burst;
+    half = nextHalf;
+    burst = nextBurst;
+  }
+#else
   for(int s = 0; s < count;) {
     int burst = ACSI_BLOCKS;
     if(burst > count - s)
@@ -557,6 +749,7 @@ Acsi::ScsiErr Acsi::processBlockWrite(uint32_t block, int count) {
 
     s += burst;
   }
+#endif
 
   blockDev->writeStop();
 
@@ -64,6 +64,9 @@ public:
   // This function will read all subsequent bytes as needed.
   void process(uint8_t cmd);
 
+  // Process a command once the slot is known to be enabled
+  void processCommand(uint8_t cmd);
+
   // Read command bytes and updates cmdBuf and cmdLen.
   void readCmdBuf(uint8_t cmd);
 
@@ -73,6 +76,12 @@ public:
   // Return the LUN for the current command.
   int getLun();
 
+#if ACSI_NULL_LUN
+  // Process a command on the synthetic ACSI_NULL_LUN device.
+  // Returns false if the command is not supported by the synthetic device.
+  bool processNullLun();
+#endif
+
   // Send a status and get ready for the next command.
   // Also updates lastErr, lastSeek and lastBlock.
   void commandStatus(ScsiErr err, uint32_t lastBlock);
@@ -16,6 +16,10 @@
  */
 
 #include "BlockDev.h"
+#include "Counters.h"
+#include "FatCache.h"
+#include "Profile.h"
+#include "Trim.h"
 
 #include "SdFat.h"
 #if ! ACSI_STRICT
@@ -33,6 +37,20 @@ static const uint32_t sdRates[] = {
   SD_SCK_MHZ(1) // Fallback to a horribly slow speed (should never happen)
 };
 
+// Erase sectors in fixed size chunks.
+// The time taken by each chunk depends on the card.
+static bool eraseSectors(SdSpiCard &card, uint32_t first, uint32_t count) {
+  static const uint32_t chunk = 0x100000; // 512MB
+  while(count) {
+    uint32_t n = count < chunk ? count : chunk;
+    if(!card.erase(first, first + n - 1))
+      return false;
+    first += n;
+    count -= n;
+  }
+  return true;
+}
+
 bool BlockDev::updateBootable() {
   bootable = false;
 
@@ -55,7 +73,7 @@ readFail:
   return false;
 }
 
-ImageDev::ImageDev(SdDev &sd_): sd(sd_), sdMediaId(0) {}
+ImageDev::ImageDev(SdDev &sd_): sd(sd_), sdMediaId(0), firstSector(0) {}
 
 bool ImageDev::open(const char *path) {
   close();
@@ -92,6 +110,14 @@ bool ImageDev::open(const char *path) {
   }
 
   blocks = image.fileSize() / ACSI_BLOCKSIZE;
+
+  // Scan the cluster chain once to enable direct access
+  uint32_t lastSector;
+  if(!image.contiguousRange(&firstSector, &lastSector))
+    firstSector = 0;
+  else
+    verbose(" contiguous");
+
   verbose(" opened\n");
 
   return true;
@@ -102,17 +128,32 @@ void ImageDev::close() {
   blocks = 0;
   bootable = false;
   sdMediaId = 0;
+  firstSector = 0;
 }
 
 bool ImageDev::readStart(uint32_t block) {
+  if(firstSector)
+    return sd.card.readStart(firstSector + block);
   return image.seekSet((uint64_t)block * ACSI_BLOCKSIZE);
 }
 
 bool ImageDev::readData(uint8_t *data, int count) {
+  ACSI_PROFILE_ZONE(SD_READ);
+  Counters::sdRead(count);
+  if(firstSector) {
+    while(count-- > 0) {
+      if(!sd.card.readData(data))
+        return false;
+      data += ACSI_BLOCKSIZE;
+    }
+    return true;
+  }
   return image.read(data, ACSI_BLOCKSIZE * count) == ACSI_BLOCKSIZE * count;
 }
 
 bool ImageDev::readStop() {
+  if(firstSector)
+    return sd.card.readStop();
   return true;
 }
 
@@ -127,11 +168,14 @@ bool ImageDev::writeStart(uint32_t block) {
 #else
   if(!isWritable())
     return false;
+  if(firstSector)
+    return sd.card.writeStart(firstSector + block);
   return image.seekSet((uint64_t)block * ACSI_BLOCKSIZE);
 #endif
 }
 
 bool ImageDev::writeData(const uint8_t *data, int count) {
+  ACSI_PROFILE_ZONE(SD_WRITE);
 #if ACSI_READONLY
   (void)data;
   (void)count;
@@ -143,6 +187,15 @@ bool ImageDev::writeData(const uint8_t *data, int count) {
 #else
   if(!image.isWritable())
     return false;
+  Counters::sdWritten(count);
+  if(firstSector) {
+    while(count-- > 0) {
+      if(!sd.card.writeData(data))
+        return false;
+      data += ACSI_BLOCKSIZE;
+    }
+    return true;
+  }
   return image.write(data, ACSI_BLOCKSIZE * count);
 #endif
 }
@@ -155,6 +208,8 @@ bool ImageDev::writeStop() {
   return false;
 #endif
 #else
+  if(firstSector)
+    return sd.card.writeStop();
   image.flush();
   return true;
 #endif
@@ -164,6 +219,19 @@ bool ImageDev::isWritable() {
   return image.isWritable();
 }
 
+bool ImageDev::erase() {
+#if ACSI_READONLY
+  return ACSI_READONLY == 2;
+#else
+  if(!isWritable())
+    return false;
+  if(firstSector)
+    return eraseSectors(sd.card, firstSector, blocks);
+  // Fragmented images cannot be erased: leave data in place
+  return true;
+#endif
+}
+
 uint32_t ImageDev::mediaId(BlockDev::MediaIdMode mode) {
   // For now, images cannot be switched on the fly so they cannot change
   // unless the SD card is physically swapped. Derive mediaId from the SD
@@ -190,15 +258,27 @@ void SdDev::init() {
   // Set wp pin as input pullup to read write lock later
   pinMode(wpPin, INPUT_PULLUP);
 
+  rawWritten = false;
+  initPending = false;
+
   dbg("\n        SD", slot, ' ');
 
   unsigned int rate;
   for(rate = 0; rate < sizeof(sdRates)/sizeof(sdRates[0]); ++rate) {
-    for(int i = 0; i < 2; ++i)
+    for(int i = 0; i < 2; ++i) {
       if(card.begin(SdSpiConfig(csPin, SHARED_SPI, sdRates[rate], &SPI)))
         goto beginOk;
-      else
-        delay(10);
+
+      // Nothing answered the reset command: the slot is empty.
+      // The reset is done at low speed anyway, so don't retry.
+      // Drop the state of any card that was there before.
+      if(card.errorCode() == SD_CARD_ERROR_CMD0) {
+        reset();
+        goto noCard;
+      }
+
+      delay(10);
+    }
 
     verbose("error ");
     reset();
@@ -227,14 +307,7 @@ beginOk:
     if(!blocks)
       continue;
 
-    // Get writable pin status
-#if !ACSI_SD_WRITE_LOCK
-    writable = true;
-#elif ACSI_SD_WRITE_LOCK == 1
-    writable = digitalRead(wpPin);
-#elif ACSI_SD_WRITE_LOCK == 2
-    writable = !digitalRead(wpPin);
-#endif
+    updateWritable();
 
     uint32_t id = mediaId(FORCE);
 
@@ -255,6 +328,7 @@ beginOk:
 #if ! ACSI_STRICT
     if(fs.fatType() && !image && !bootable)
       mountable = true;
+    startFreeClusterScan();
 #endif
 
     if(image)
@@ -267,6 +341,7 @@ beginOk:
     break;
   }
 
+noCard:
   if(!lastMediaId) {
     dbg("no SD ");
     reset();
@@ -288,8 +363,10 @@ void SdDev::onReset() {
   }
 
   // Try to initialize the SD card
-  mode = ACSI; // Enable the slot
-  init();
+  if(!warmRestart()) {
+    mode = ACSI; // Enable the slot
+    init();
+  }
 
   mode = computeMode();
 
@@ -369,6 +446,8 @@ bool SdDev::readStart(uint32_t block) {
 }
 
 bool SdDev::readData(uint8_t *data, int count) {
+  ACSI_PROFILE_ZONE(SD_READ);
+  Counters::sdRead(count);
   while(count-- > 0) {
     if(!card.readData(data))
       return false;
@@ -393,11 +472,16 @@ bool SdDev::writeStart(uint32_t block) {
 #else
   if(!writable)
     return false;
+  // Raw writes may change the file system
+  FatCache::invalidate(this);
+  Trim::clear(this);
+  rawWritten = true;
   return card.writeStart(block);
 #endif
 }
 
 bool SdDev::writeData(const uint8_t *data, int count) {
+  ACSI_PROFILE_ZONE(SD_WRITE);
 #if ACSI_READONLY
   (void)data;
   (void)count;
@@ -409,6 +493,7 @@ bool SdDev::writeData(const uint8_t *data, int count) {
 #else
   if(!writable)
     return false;
+  Counters::sdWritten(count);
   while(count-- > 0) {
     if(!card.writeData(data))
       return false;
@@ -437,24 +522,56 @@ bool SdDev::isWritable() {
   return writable;
 }
 
+bool SdDev::erase() {
+#if ACSI_READONLY
+  return ACSI_READONLY == 2;
+#else
+  if(!writable)
+    return false;
+  // The file system is gone
+  FatCache::invalidate(this);
+  Trim::clear(this);
+  rawWritten = true;
+  return eraseSectors(card, 0, blocks);
+#endif
+}
+
 uint32_t SdDev::mediaId(BlockDev::MediaIdMode mediaIdMode) {
   if(mode == DISABLED)
     return 0;
 
-  verbose("id", slot, " ", mediaIdMode ," ");
+  // Polling happens in the background: don't flood verbose output
+  bool quiet = mediaIdMode == BlockDev::POLL;
+
+  if(!quiet)
+    verbose("id", slot, " ", mediaIdMode ," ");
+
+  if(initPending && mediaIdMode == BlockDev::NORMAL) {
+    // A card change was detected while idle
+    init();
+    return lastMediaId;
+  }
 
   uint32_t now = millis();
   if(mediaIdMode != BlockDev::FORCE) {
-    if(mediaIdMode == BlockDev::CACHED || now - lastMediaCheckTime <= mediaCheckPeriod) {
-      verbose("cached ");
+    if(mediaIdMode != BlockDev::POLL || now - lastMediaCheckTime <= pollPeriod()) {
+      if(!quiet)
+        verbose("cached ");
       return lastMediaId;
     }
   }
 
   lastMediaCheckTime = now;
 
+  if(mediaIdMode == BlockDev::POLL && !blocks) {
+    // Empty slot: initialize on the next access if a card answers
+    initPending = probeCard();
+    return 0;
+  }
+
   cid_t cid;
-  if(!card.readCID(&cid)) {
+  bool present = card.readCID(&cid);
+  if(!present) {
     // SD has an issue
     verbose("CID error ");
 
@@ -467,6 +584,12 @@ uint32_t SdDev::mediaId(BlockDev::MediaIdMode mediaIdMode) {
       // The caller wants the truth: don't lie
       return 0;
 
+    if(mediaIdMode == POLL) {
+      // Don't block the idle loop: recover on the next access
+      initPending = true;
+      return 0;
+    }
+
     // Try to recover
     init();
 
@@ -503,11 +626,56 @@ uint32_t SdDev::mediaId(BlockDev::MediaIdMode mediaIdMode) {
 
   lastMediaId = id;
 
-  verboseHex(id, " ");
+  if(!quiet)
+    verboseHex(id, " ");
 
   return id;
 }
 
+bool SdDev::pollMedia() {
+  if(mode == DISABLED || initPending
+      || millis() - lastMediaCheckTime <= pollPeriod())
+    return false;
+
+  mediaId(POLL);
+  return true;
+}
+
+uint32_t SdDev::pollPeriod() const {
+  return blocks ? mediaCheckPeriod : emptyCheckPeriod;
+}
+
+bool SdDev::probeCard() {
+  // Send a single reset command (CMD0) at 400kHz. This is what card.begin
+  // does first, without its retry loop and the rest of the initialization.
+  static const uint8_t cmd0[] = { 0x40, 0x00, 0x00, 0x00, 0x00, 0x95 };
+
+  pinMode(csPin, OUTPUT);
+  digitalWrite(csPin, HIGH);
+  SPI.begin();
+  SPI.beginTransaction(SPISettings(400000, MSBFIRST, SPI_MODE0));
+
+  // At least 74 clocks with CS high to wake up a newly inserted card
+  for(int i = 0; i < 10; ++i)
+    SPI.transfer(0xff);
+
+  digitalWrite(csPin, LOW);
+  for(unsigned int i = 0; i < sizeof(cmd0); ++i)
+    SPI.transfer(cmd0[i]);
+
+  // The card answers within 8 bytes. An empty slot reads 0xff.
+  uint8_t r1 = 0xff;
+  for(int i = 0; i < 8 && (r1 & 0x80); ++i)
+    r1 = SPI.transfer(0xff);
+
+  digitalWrite(csPin, HIGH);
+  SPI.transfer(0xff);
+  SPI.endTransaction();
+
+  // Idle state, no error
+  return r1 == 0x01;
+}
+
 void SdDev::disable() {
   reset();
   mode = DISABLED;
@@ -544,8 +712,152 @@ void SdDev::reset() {
   bootable = false;
 #if ! ACSI_STRICT
   mountable = false;
+  freeClusters = -1;
+  freeScanCluster = 0;
+  freeScanDelta = 0;
 #endif
   lastMediaCheckTime = millis();
   lastMediaId = 0;
+  FatCache::invalidate(this);
+  Trim::clear(this);
+}
+
+#if ! ACSI_STRICT
+uint32_t SdDev::getFreeClusters() {
+  if(freeClusters < 0) {
+    while(scanFreeClusters());
+
+    // exFAT, FAT12 or read error: let SdFat do the work
+    if(freeClusters < 0)
+      freeClusters = fs.freeClusterCount();
+    if(freeClusters < 0)
+      return 0;
+  }
+  return freeClusters;
+}
+
+bool SdDev::scanFreeClusters() {
+  if(!freeScanCluster || mode != GEMDRIVE)
+    return false;
+
+  // Entries are 4 bytes on FAT32, 2 bytes on FAT16
+  bool fat32 = fs.fatType() == FAT_TYPE_FAT32;
+  uint32_t entries = fat32 ? ACSI_BLOCKSIZE / 4 : ACSI_BLOCKSIZE / 2;
+  uint32_t end = fs.clusterCount() + 2;
+
+  // Write FAT changes cached by SdFat before reading the FAT directly
+  uint8_t sector[ACSI_BLOCKSIZE];
+  if(!TinyFile::syncVolume(fs)
+     || !card.readSector(fs.fatStartSector() + freeScanCluster / entries, sector)) {
+    freeScanCluster = 0;
+    return false;
+  }
+
+  uint32_t first = freeScanCluster % entries;
+  uint32_t last = entries;
+  if(last > end - freeScanCluster + first)
+    last = end - freeScanCluster + first;
+
+  for(uint32_t i = first; i < last; ++i) {
+    if(fat32) {
+      if(!((sector[i * 4] | sector[i * 4 + 1] | sector[i * 4 + 2]
+            | (sector[i * 4 + 3] & 0x0f))))
+        ++freeScanCount;
+    } else if(!(sector[i * 2] | sector[i * 2 + 1])) {
+      ++freeScanCount;
+    }
+  }
+
+  freeScanCluster += last - first;
+  if(freeScanCluster < end)
+    return true;
+
+  dbg("SD", slot, ' ', freeScanCount, " free clusters ");
+  freeClusters = freeScanCount + freeScanDelta;
+  if(freeClusters < 0)
+    freeClusters = 0;
+  freeScanCluster = 0;
+  return false;
+}
+
+void SdDev::adjustFreeClusters(int32_t delta) {
+  if(!delta)
+    return;
+
+  FatCache::invalidate(this);
+  ++fatChanges;
+  if(freeClusters >= 0)
+    freeClusters += delta;
+  else if(freeScanCluster)
+    // Applied when the scan ends. Clusters in the part not scanned yet are
+    // counted twice, so the error is bounded by what changed during the scan.
+    freeScanDelta += delta;
+}
+
+uint32_t SdDev::sizeToClusters(uint64_t size) {
+  uint32_t clusterSize = fs.bytesPerCluster();
+  return (size + clusterSize - 1) / clusterSize;
 }
 
+void SdDev::folderGrown(FsFile &folder, int32_t before) {
+  if(fs.fatType() == FAT_TYPE_EXFAT)
+    // SdFat keeps the length of exFAT folders in the handle used to add the
+    // entry, not in this one: growth is not tracked. It is rare enough.
+    return;
+
+  int32_t after = TinyFile::getClusterCount(fs, folder);
+  if(before < 0 || after < 0)
+    // Read error: count again
+    startFreeClusterScan();
+  else
+    adjustFreeClusters(before - after);
+}
+
+void SdDev::startFreeClusterScan() {
+  FatCache::invalidate(this);
+  ++fatChanges;
+  freeClusters = -1;
+  freeScanCount = 0;
+  freeScanDelta = 0;
+  if(mountable && (fs.fatType() == FAT_TYPE_FAT16 || fs.fatType() == FAT_TYPE_FAT32))
+    freeScanCluster = 2;
+  else
+    freeScanCluster = 0;
+}
+#endif
+
+bool SdDev::warmRestart() {
+  uint32_t id = lastMediaId;
+
+  // The reset interrupted a command: the card may be in the middle of a
+  // transfer. Raw writes may have changed the partition table.
+  if(!id || Devices::processing || rawWritten)
+    return false;
+
+  // Check that the card still answers and was not swapped
+  if(card.status() || mediaId(FORCE) != id)
+    return false;
+
+#if ! ACSI_PIO
+  // The ST may have written a new boot sector in the image
+  if(!(*this)->updateBootable())
+    return false;
+#endif
+
+  pinMode(wpPin, INPUT_PULLUP);
+  updateWritable();
+
+  dbg("\n        SD", slot, " unchanged ");
+
+  return true;
+}
+
+void SdDev::updateWritable() {
+#if !ACSI_SD_WRITE_LOCK
+  writable = true;
+#elif ACSI_SD_WRITE_LOCK == 1
+  writable = digitalRead(wpPin);
+#elif ACSI_SD_WRITE_LOCK == 2
+  writable = !digitalRead(wpPin);
+#endif
+}
@@ -28,9 +28,10 @@
 class BlockDev: public Monitor, public Devices {
 public:
   enum MediaIdMode {
-    NORMAL, // Refresh cache after some time has passed
+    NORMAL, // Return the value kept up to date by polling when idle
     FORCE, // Don't use cache, don't reinit a failed drive
     CACHED, // Return the value in cache
+    POLL, // Refresh cache after some time has passed
   };
 
   // Read/write functions
@@ -42,6 +43,9 @@ public:
   virtual bool writeStop() = 0;
   virtual bool isWritable() = 0;
 
+  // Erase all blocks. Used by FORMAT UNIT.
+  virtual bool erase() = 0;
+
   // Return a (hopefully) unique id for this media
   // Returns 0 if no device is present
   // Also serves as a device state detection and refresh
@@ -76,6 +80,7 @@ public:
   virtual bool writeData(const uint8_t *data, int count = 1);
   virtual bool writeStop();
   virtual bool isWritable();
+  virtual bool erase();
   virtual uint32_t mediaId(MediaIdMode mode = NORMAL);
 
   SdDev &sd;
@@ -83,6 +88,11 @@ public:
 
 protected:
   uint32_t sdMediaId; // SD card owning the current image
+
+  // First SD card sector if the image is contiguous, 0 otherwise.
+  // Contiguous images are accessed directly on the SD card with multi-block
+  // transfers, bypassing the file system.
+  uint32_t firstSector;
 };
 
 // Actual SD card slot
@@ -122,14 +132,46 @@ public:
   virtual bool writeData(const uint8_t *data, int count = 1);
   virtual bool writeStop();
   virtual bool isWritable();
+  virtual bool erase();
   virtual uint32_t mediaId(MediaIdMode = NORMAL);
 
+  // Check for media change if the last check is too old.
+  // Called while waiting for commands, so mediaId doesn't need to access the
+  // SD card. Returns true if the card was accessed.
+  // Empty slots are checked less often, with a single reset command.
+  // A new or failed card is initialized by the next mediaId call.
+  bool pollMedia();
+
   // Permanently disable the slot
   void disable();
 
   // Get the actual mode
   Mode computeMode();
 
+#if ! ACSI_STRICT
+  // Return the number of free clusters of the file system.
+  // The value is computed once by scanning the FAT in the background, then
+  // kept up to date by adjustFreeClusters. Finishes the scan if needed.
+  uint32_t getFreeClusters();
+
+  // Scan one FAT sector to count free clusters.
+  // Returns false if there is nothing left to do.
+  bool scanFreeClusters();
+
+  // Account clusters freed (positive) or allocated (negative) by GemDrive
+  void adjustFreeClusters(int32_t delta);
+
+  // Return the number of clusters used by a file of a given size
+  uint32_t sizeToClusters(uint64_t size);
+
+  // Account the growth of a folder after adding entries to it.
+  // before is the result of TinyFile::getClusterCount before the change.
+  void folderGrown(FsFile &folder, int32_t before);
+
+  // Reset the free cluster count and start a new background scan
+  void startFreeClusterScan();
+#endif
+
   SdSpiCard card;
   FsVolume fs;
   ImageDev image;
@@ -139,6 +181,7 @@ public:
   bool writable;
 #if ! ACSI_STRICT
   bool mountable;
+  uint32_t fatChanges = 0; // Incremented whenever GemDrive changes the FAT
 #else
   static const bool mountable = false;
 #endif
@@ -147,11 +190,33 @@ public:
   int wpPin;
 
   friend class ImageDev;
-protected:
   static const uint32_t mediaCheckPeriod = 500;
+  static const uint32_t emptyCheckPeriod = 5000;
+protected:
   uint32_t lastMediaId;
   uint32_t lastMediaCheckTime;
+#if ! ACSI_STRICT
+  int32_t freeClusters = -1; // -1 if unknown
+  uint32_t freeScanCluster = 0; // Next cluster to scan, 0 if not scanning
+  uint32_t freeScanCount = 0; // Free clusters found by the current scan
+  int32_t freeScanDelta = 0; // Clusters freed or allocated during the scan
+#endif
+  bool rawWritten = false; // Written in ACSI mode since the last init
+  bool initPending = false; // Card change detected by pollMedia
   void reset();
+
+  // Keep the current state across an Atari reset if the card is unchanged.
+  // Returns false if the card needs a full init.
+  bool warmRestart();
+
+  // Read the write lock pin
+  void updateWritable();
+
+  // Media check period in milliseconds: longer for an empty slot
+  uint32_t pollPeriod() const;
+
+  // Check if a card answers a single reset command
+  bool probeCard();
 };
 
 #endif
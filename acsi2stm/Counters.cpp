@@ -0,0 +1,75 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Counters.h"
+#include "FatCache.h"
+#include "SysHook.h"
+
+#if ACSI_COUNTERS
+#if ACSI_BLOCKS < 4
+#error ACSI_COUNTERS requires ACSI_BLOCKS to be at least 4
+#endif
+
+static uint8_t * putOps(uint8_t *bytes, const Counters::Op *ops, int count) {
+  for(int i = 0; i < count; ++i) {
+    ToLong(ops[i].calls).set(&bytes[0]);
+    ToLong(ops[i].total).set(&bytes[4]);
+    ToLong(ops[i].max).set(&bytes[8]);
+    bytes += 12;
+  }
+  return bytes;
+}
+
+void Counters::reset() {
+  sentBytes = 0;
+  readBytes = 0;
+  readBlocks = 0;
+  writtenBlocks = 0;
+  sysHookRoundTrips = 0;
+#if ACSI_GEMDRIVE_FAT_CACHE && ! ACSI_STRICT
+  FatCache::hits = 0;
+  FatCache::misses = 0;
+#endif
+  for(int i = 0; i < acsiOps; ++i)
+    acsiStats[i] = Op();
+  for(int i = 0; i < gemdosOps; ++i)
+    gemdosStats[i] = Op();
+}
+
+void Counters::write(uint8_t *bytes) {
+  memset(bytes, 0, 32);
+  ToLong(sentBytes).set(&bytes[0]);
+  ToLong(readBytes).set(&bytes[4]);
+  ToLong(readBlocks).set(&bytes[8]);
+  ToLong(writtenBlocks).set(&bytes[12]);
+  ToLong(sysHookRoundTrips).set(&bytes[16]);
+  ToLong(FatCache::hits).set(&bytes[20]);
+  ToLong(FatCache::misses).set(&bytes[24]);
+  bytes = putOps(&bytes[32], acsiStats, acsiOps);
+  putOps(bytes, gemdosStats, gemdosOps);
+}
+
+uint32_t Counters::sentBytes;
+uint32_t Counters::readBytes;
+uint32_t Counters::readBlocks;
+uint32_t Counters::writtenBlocks;
+uint32_t Counters::sysHookRoundTrips;
+Counters::Op Counters::acsiStats[Counters::acsiOps];
+Counters::Op Counters::gemdosStats[Counters::gemdosOps];
+#endif
+
+// vim: ts=2 sw=2 sts=2 et
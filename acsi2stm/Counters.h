@@ -0,0 +1,148 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include "acsi2stm.h"
+#include "Monitor.h"
+
+// Performance counters for profiling real workloads from the ST.
+//
+// Counts bytes transferred by DMA, SD blocks and SysHook round trips, and
+// measures calls, cumulative time and maximum time of each ACSI and GEMDOS
+// opcode.
+//
+// Counters are read by the ST with the "ACSICntRd" vendor command and reset
+// with "ACSICntRs". The "ACSICntRd" command transfers 4 blocks (2048 bytes),
+// all values are big endian Longs:
+//
+//    0: DMA bytes sent to the ST
+//    4: DMA bytes read from the ST
+//    8: SD blocks read
+//   12: SD blocks written
+//   16: SysHook round trips
+//   20: GemDrive FAT cache hits
+//   24: GemDrive FAT cache misses
+//   28: reserved (4 bytes)
+//   32: ACSI opcodes 0x00 to 0x3f (acsiOps entries)
+//  800: GEMDOS opcodes 0x00 to 0x5f (gemdosOps entries)
+//
+// In both tables, the last entry also counts all higher opcodes.
+//
+// Each opcode entry is 12 bytes: calls, total time in microseconds and
+// maximum time of a single call in microseconds.
+struct Counters {
+  static const int acsiOps = 0x40;
+  static const int gemdosOps = 0x60;
+
+  // Size of the data returned by write
+  static const int size = 32 + (acsiOps + gemdosOps) * 12;
+
+  struct Op {
+    uint32_t calls;
+    uint32_t total; // Total time in microseconds
+    uint32_t max; // Maximum time of a single call in microseconds
+
+    void add(uint32_t cycles) {
+      uint32_t us = cycles / CYCLES_PER_MICROSECOND;
+      ++calls;
+      total += us;
+      if(us > max)
+        max = us;
+    }
+  };
+
+#if ACSI_COUNTERS
+  // Setup the cycle counter
+  static void begin() {
+    Monitor::beginCycles();
+  }
+
+  static void dmaSent(int count) {
+    sentBytes += count;
+  }
+
+  static void dmaRead(int count) {
+    readBytes += count;
+  }
+
+  static void sdRead(int count) {
+    readBlocks += count;
+  }
+
+  static void sdWritten(int count) {
+    writtenBlocks += count;
+  }
+
+  static void sysHook() {
+    ++sysHookRoundTrips;
+  }
+
+  // Account an ACSI command
+  static void acsi(uint8_t op, uint32_t cycles) {
+    acsiStats[op < acsiOps ? op : acsiOps - 1].add(cycles);
+  }
+
+  // Account a GEMDOS call
+  static void gemdos(uint16_t op, uint32_t cycles) {
+    gemdosStats[op < gemdosOps ? op : gemdosOps - 1].add(cycles);
+  }
+
+  // Clear all counters
+  static void reset();
+
+  // Write all counters in the format described above.
+  // bytes must be able to hold size bytes.
+  static void write(uint8_t *bytes);
+
+  static uint32_t sentBytes;
+  static uint32_t readBytes;
+  static uint32_t readBlocks;
+  static uint32_t writtenBlocks;
+  static uint32_t sysHookRoundTrips;
+  static Op acsiStats[acsiOps];
+  static Op gemdosStats[gemdosOps];
+#else
+  static void begin() {}
+  static void dmaSent(int) {}
+  static void dmaRead(int) {}
+  static void sdRead(int) {}
+  static void sdWritten(int) {}
+  static void sysHook() {}
+  static void acsi(uint8_t, uint32_t) {}
+  static void gemdos(uint16_t, uint32_t) {}
+#endif
+};
+
+// Account a GEMDOS call between construction and destruction
+struct GemdosCounter {
+#if ACSI_COUNTERS
+  GemdosCounter(uint16_t op_): op(op_), start(Monitor::cycles()) {}
+  ~GemdosCounter() {
+    Counters::gemdos(op, Monitor::cycles() - start);
+  }
+
+  uint16_t op;
+  uint32_t start;
+#else
+  GemdosCounter(uint16_t) {}
+#endif
+};
+
+// vim: ts=2 sw=2 sts=2 et
+#endif
@@ -20,6 +20,8 @@
 #include "Acsi.h"
 #include "BlockDev.h"
 #include "GemDrive.h"
+#include "Idle.h"
+#include "Trim.h"
 
 #include <libmaple/iwdg.h>
 
@@ -76,6 +78,16 @@ GemDrive Devices::drives[] = {
 };
 #endif
 
+void Devices::begin() {
+  Idle::add(pollMedia, Idle::NORMAL, SdDev::mediaCheckPeriod);
+#if ! ACSI_STRICT
+  Idle::add(scanFreeClusters, Idle::LOW);
+#endif
+#if ACSI_SD_TRIM && ! ACSI_STRICT
+  Idle::add(Trim::run, Idle::LOW);
+#endif
+}
+
 void Devices::sense() {
 #if ACSI_RTC
   FsDateTime::setCallback(getDateTime);
@@ -113,14 +125,35 @@ end:
 #if ! ACSI_STRICT
   GemDrive::closeAll();
 #endif
+  // Slots are initialized one after the other: card.begin runs the whole SD
+  // power up sequence as a single blocking call. Empty slots fail fast.
+  uint32_t start = millis();
   for(int c = 0; c < sdCount; ++c) {
     sdSlots[c].onReset();
 #if ! ACSI_PIO
     acsi[c].onReset();
 #endif
   }
+  Monitor::dbg("\n        Ready in ", millis() - start, "ms");
 }
 
+bool Devices::pollMedia() {
+  for(int s = 0; s < sdCount; ++s)
+    if(!Trim::busy(&sdSlots[s]) && sdSlots[s].pollMedia())
+      return true;
+  return false;
+}
+
+#if ! ACSI_STRICT
+bool Devices::scanFreeClusters() {
+  for(int s = 0; s < sdCount; ++s)
+    if(!Trim::busy(&sdSlots[s]) && sdSlots[s].scanFreeClusters())
+      return true;
+  return false;
+}
+#endif
+
+bool Devices::processing = false;
 int Devices::acsiDeviceMask = 0;
 #if ! ACSI_STRICT
 int Devices::gemDriveMask = 0;
@@ -185,7 +218,7 @@ bool Devices::strict = false;
 int Devices::acsiFirstId = ACSI_FIRST_ID;
 #endif
 
-uint8_t Devices::buf[ACSI_BLOCKSIZE * ACSI_BLOCKS];
+uint8_t Devices::buf[ACSI_BLOCKSIZE * ACSI_BLOCKS] __attribute__((aligned(4)));
 RTClock Devices::rtc(RTCSEL_LSE);
 
 int Devices::computeChecksum(uint8_t *block) {
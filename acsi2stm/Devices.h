@@ -39,9 +39,24 @@ struct Devices {
   static GemDrive drives[];
 #endif
 
+  // Register background tasks
+  static void begin();
+
   // Sense jumper settings
   static void sense();
 
+  // Idle task: check one SD slot for media change
+  static bool pollMedia();
+
+#if ! ACSI_STRICT
+  // Idle task: scan one FAT sector of the first slot that needs it
+  static bool scanFreeClusters();
+#endif
+
+  // True while a command is processed. SD cards are fully initialized again
+  // if the ST is reset at that time.
+  static bool processing;
+
   static const int sdCount = ACSI_SD_CARDS;
   static int acsiDeviceMask;
 #if ! ACSI_STRICT
@@ -95,6 +95,27 @@ timer, so it has to be a memory to peripheral copy. Any unused peripheral
 register can be used for this task.
 
 
+PIO streaming
+-------------
+
+In PIO mode, data transfers don't use the IRQ handshake between bytes: the ST
+reads or writes the data register as fast as it can, so the STM32 must keep up
+with each CS pulse.
+
+If ACSI_PIO_STREAM is enabled, Timer4 is not re-armed for each byte. It is left
+running without one-pulse mode, so both edges of a CS pulse generate an
+underflow/overflow event. DMA1 CH7 is switched to a circular RAM buffer that
+contains 2 entries per byte:
+
+ * When CS goes low, the current byte is copied to GPIOB (sending) or GPIOB
+   is sampled (receiving).
+ * When CS goes up, the next byte is copied to GPIOB (sending) or a dummy
+   sample is taken (receiving).
+
+The CPU only refills or empties one half of the buffer while the DMA engine
+streams the other half.
+
+
 How ACSI DMA is handled (DRQ/ACK pulses and data sampling)
 ==========================================================
 
@@ -213,6 +234,31 @@ DMA block transfer stop process:
  * Disable Timer1
 
 
+Hardware DMA (ACSI_FAST_DMA 6)
+------------------------------
+
+DRQ/ACK cycles are handled without any CPU intervention:
+
+ * Timer1 is in trigger mode: ACK going low starts the counter, which runs on
+   the internal clock for ACSI_HW_DMA_CYCLE ticks then stops (one pulse mode).
+ * DRQ is low when the counter is stopped at 0 and CCR4 is 1.
+ * The trigger event starts DMA1 CH4 that sets CCR4 to 0, so DRQ is high.
+ * CC3 starts DMA1 CH6 at the end of the cycle to put the next byte on the data
+   bus.
+ * The update event starts DMA1 CH5 that sets CCR4 to 1, so DRQ goes low when
+   the counter stops. It runs one time less than CH4, so DRQ stays high after
+   the last byte.
+
+DMA1 CH5 is shared with A1 detection, which is disabled during the transfer.
+The CPU only has to wait for DMA1 CH4 to reach the end, so it can do other
+things in the meantime, such as reading the next block from the SD card.
+
+For ST -> STM32 transfers, CC3 matches right after the trigger instead, and
+DMA1 CH6 reads GPIOB IDR. GPIO registers must be accessed as 32 bits words
+(RM0008), so the DMA stores the low half word of IDR for each byte and waitDma
+packs the upper bytes afterwards. The destination needs twice the data size.
+
+
 How RESET is handled
 ====================
 
@@ -238,6 +284,10 @@ happened.
 #include "DmaPort.h"
 
 #include "Acsi.h"
+#include "Counters.h"
+#include "Idle.h"
+#include "Profile.h"
+#include "Trace.h"
 
 #include <libmaple/dma.h>
 
@@ -281,6 +331,7 @@ void DmaPort::waitBusReady() {
   // Get ready to receive an A1 command
   armA1();
 
+  Trace::event(Trace::EVENT_BUS_READY);
   Acsi::dbg("--- Ready to go ---\n");
 }
 
@@ -300,8 +351,10 @@ uint8_t DmaPort::readCommand() {
 }
 
 uint8_t DmaPort::waitCommand() {
+  ACSI_PROFILE_ZONE(WAIT_COMMAND);
   do {
     resetTimeout();
+    Idle::run();
   } while(!checkCommand());
   return readCommand();
 }
@@ -337,6 +390,72 @@ uint8_t DmaPort::readIrq() {
   return byte;
 }
 
+void DmaPort::readCmdIrq(uint8_t *bytes, int count) {
+  resetTimeout();
+
+  Acsi::verbose("[<");
+
+  // GPIOB values on each CS edge. Data is sampled on the falling edge.
+  // Not on the stack: DMA1 CH7 still writes to it if quickReset or a timeout
+  // leaves this function early.
+  static uint16_t edges[cmdMaxSize * 2];
+
+  // Keep counting CS edges, each of them triggers a DMA1 CH7 transfer
+  waitCsUp();
+  CS_TIMER->CR1 &= ~(TIMER_CR1_OPM | TIMER_CR1_CEN);
+  CS_TIMER->CNT = 0;
+
+  DMA1_BASE->CCR7 &= ~DMA_CCR_EN;
+  DMA1_BASE->CPAR7 = (uint32_t)&(GPIOB->regs->IDR);
+  DMA1_BASE->CMAR7 = (uint32_t)edges;
+  DMA1_BASE->CNDTR7 = count * 2;
+  DMA1_BASE->IFCR = DMA_IFCR_CGIF5 | DMA_IFCR_CGIF7;
+  DMA1_BASE->CCR7 = DMA_CCR_PL_VERY_HIGH
+                    | DMA_CCR_MSIZE_16BITS
+                    | DMA_CCR_PSIZE_32BITS
+                    | DMA_CCR_MINC
+                    | DMA_CCR_EN;
+
+  CS_TIMER->CR1 |= TIMER_CR1_CEN;
+
+  int edge = 0;
+  for(int i = 0; i < count; ++i) {
+    resetTimeout();
+    pullIrq();
+
+    for(;;) {
+      if(count * 2 - (int)DMA1_BASE->CNDTR7 > edge) {
+        bytes[i] = edges[edge] >> 8;
+        edge += 2;
+        break;
+      }
+      if(checkCommand()) {
+#if ACSI_A1_WORKAROUND
+        // A1 pulse in the middle of a command: the byte is in CCR4
+        bytes[i] = csData();
+        DMA1_BASE->IFCR = DMA_IFCR_CTCIF5;
+        break;
+#else
+        // Spurious A1 pulse: reset
+        quickReset();
+#endif
+      }
+      checkReset();
+    }
+
+    releaseRq();
+    waitIrqUp();
+
+    Acsi::verboseHex(bytes[i]);
+  }
+
+  // Go back to the idle state
+  setupCsDma();
+  armA1();
+
+  Acsi::verbose("]");
+}
+
 void DmaPort::sendIrq(uint8_t byte) {
   resetTimeout();
 
@@ -368,6 +487,9 @@ void DmaPort::sendIrqFast(const uint8_t *bytes, int count) {
   // Disable systick that introduces jitter.
   systick_disable();
 
+#if ACSI_PIO && ACSI_PIO_STREAM
+  streamSend(bytes, 0, count);
+#else
   // Output data
   acquireDataBus();
   writeData(*bytes);
@@ -388,6 +510,7 @@ void DmaPort::sendIrqFast(const uint8_t *bytes, int count) {
   releaseDataBus();
   waitIrqUp();
   armA1();
+#endif
 
   // Restore systick
   systick_enable();
@@ -405,6 +528,9 @@ void DmaPort::repeatIrqFast(uint8_t byte, int count) {
   // Disable systick that introduces jitter.
   systick_disable();
 
+#if ACSI_PIO && ACSI_PIO_STREAM
+  streamSend(nullptr, byte, count);
+#else
   // Output data
   acquireDataBus();
   writeData(byte);
@@ -424,6 +550,7 @@ void DmaPort::repeatIrqFast(uint8_t byte, int count) {
   releaseDataBus();
   waitIrqUp();
   armA1();
+#endif
 
   // Restore systick
   systick_enable();
@@ -439,6 +566,9 @@ void DmaPort::readIrqFast(uint8_t *bytes, int count) {
   // Disable systick that introduces jitter.
   systick_disable();
 
+#if ACSI_PIO && ACSI_PIO_STREAM
+  streamRead(bytes, count);
+#else
   armCs();
   pullIrq();
 
@@ -453,6 +583,7 @@ void DmaPort::readIrqFast(uint8_t *bytes, int count) {
   releaseRq();
   waitIrqUp();
   armA1();
+#endif
 
   // Restore systick
   systick_enable();
@@ -463,6 +594,21 @@ void DmaPort::readIrqFast(uint8_t *bytes, int count) {
 }
 
 void DmaPort::readDma(uint8_t *bytes, int count) {
+  ACSI_PROFILE_ZONE(READ_DMA);
+#if ACSI_FAST_DMA == 6
+  // startReadDma needs twice the room: go through hwDmaStage
+  while(count > 0) {
+    int chunk = count;
+    if(chunk > hwDmaStageSize)
+      chunk = hwDmaStageSize;
+    startReadDma((uint8_t *)hwDmaStage, chunk);
+    waitDma();
+    memcpy(bytes, hwDmaStage, chunk);
+    bytes += chunk;
+    count -= chunk;
+  }
+#else
+  Counters::dmaRead(count);
   resetTimeout();
 
   Acsi::verbose("DMA read ");
@@ -541,9 +687,11 @@ void DmaPort::readDma(uint8_t *bytes, int count) {
 
   Acsi::verboseDump(&bytes[-i], i);
   Acsi::verbose(" OK\n");
+#endif
 }
 
 void DmaPort::readDmaString(char *bytes, int count) {
+  Counters::dmaRead(count);
   resetTimeout();
 
   Acsi::verbose("DMA string '");
@@ -586,6 +734,12 @@ void DmaPort::readDmaString(char *bytes, int count) {
 }
 
 void DmaPort::sendDma(const uint8_t *bytes, int count) {
+  ACSI_PROFILE_ZONE(SEND_DMA);
+#if ACSI_FAST_DMA == 6
+  startSendDma(bytes, count);
+  waitDma();
+#else
+  Counters::dmaSent(count);
   Acsi::verbose("DMA send ");
   Acsi::verboseDump(&bytes[0], count);
 
@@ -709,11 +863,18 @@ void DmaPort::sendDma(const uint8_t *bytes, int count) {
   armA1();
 
   Acsi::verbose(" OK\n");
+#endif
 }
 
 void DmaPort::fillDma(uint8_t byte, int count) {
   Acsi::verboseHex("DMA fill ", count, "x:", byte, '\n');
+  Counters::dmaSent(count);
 
+#if ACSI_FAST_DMA == 6
+  hwDmaFill = byte;
+  startHwSend(&hwDmaFill, count, false);
+  waitDma();
+#else
   resetTimeout();
 
   // Disable systick that introduces jitter.
@@ -778,8 +939,318 @@ void DmaPort::fillDma(uint8_t byte, int count) {
   armA1();
 
   Acsi::verbose(" OK\n");
+#endif
+}
+
+#if ACSI_FAST_DMA == 6
+void DmaPort::startSendDma(const uint8_t *bytes, int count) {
+  Acsi::verbose("DMA send ");
+  Acsi::verboseDump(&bytes[0], count);
+  Counters::dmaSent(count);
+
+  startHwSend(bytes, count, true);
+}
+
+void DmaPort::startReadDma(uint8_t *bytes, int count) {
+  Acsi::verbose("DMA read ");
+  Counters::dmaRead(count);
+
+  resetTimeout();
+
+  disableAckFilter();
+
+  hwDmaReadBytes = bytes;
+  hwDmaReadCount = count;
+  hwDmaOdr = GPIOB->regs->ODR & 0x00ff;
+
+  // DMA1 CH6 copies PORTB to memory right after ACK goes low.
+  // GPIO registers must be read as 32 bits words. The DMA keeps the low half
+  // word, and waitDma extracts PORTB[8:15] from it.
+  DMA1_BASE->CCR6 = 0;
+  DMA1_BASE->CPAR6 = (uint32_t)&(GPIOB->regs->IDR);
+  DMA1_BASE->CMAR6 = (uint32_t)bytes;
+  DMA1_BASE->CNDTR6 = count;
+  DMA1_BASE->CCR6 = DMA_CCR_PL_VERY_HIGH
+                    | DMA_CCR_MSIZE_16BITS
+                    | DMA_CCR_PSIZE_32BITS
+                    | DMA_CCR_MINC
+                    | DMA_CCR_EN;
+  DMA_TIMER->CCR3 = 1;
+
+  startHwDma(count);
+}
+
+void DmaPort::waitDma() {
+  // Wait until all ACK were received and the last cycle is finished.
+  // Reset the timeout as long as bytes are flowing.
+  uint32_t remaining = DMA1_BASE->CNDTR4;
+  resetTimeout();
+  while(DMA1_BASE->CNDTR4 || (DMA_TIMER->CR1 & TIMER_CR1_CEN)) {
+    if(DMA1_BASE->CNDTR4 != remaining) {
+      remaining = DMA1_BASE->CNDTR4;
+      resetTimeout();
+    }
+    checkReset();
+  }
+
+  releaseRq();
+
+  // Stop DMA channels and restore timers
+  DMA1_BASE->CCR4 = 0;
+  Acsi::releaseDbg();
+  disableDmaRead();
+  setupDrqTimer();
+  setupA1Dma();
+  CS_TIMER->DIER |= TIMER_DIER_CC3DE;
+
+  // Restore the PORTB[0:7] pulls overwritten by byte writes
+  GPIOB->regs->ODR = hwDmaOdr;
+  releaseDataBus();
+
+  armA1();
+
+  if(hwDmaReadBytes) {
+    // Keep the upper byte of each half word
+    for(int i = 0; i < hwDmaReadCount; ++i)
+      hwDmaReadBytes[i] = hwDmaReadBytes[i * 2 + 1];
+    Acsi::verboseDump(hwDmaReadBytes, hwDmaReadCount);
+    hwDmaReadBytes = nullptr;
+  }
+  Acsi::verbose(" OK\n");
+}
+
+void DmaPort::startHwSend(const uint8_t *bytes, int count, bool inc) {
+  resetTimeout();
+
+  enableAckFilter();
+
+  // PORTB[0:7] are inputs whose ODR bits select pull-up or pull-down, such
+  // as the write lock pins. Save them before writeData and DMA clobber them.
+  hwDmaOdr = GPIOB->regs->ODR & 0x00ff;
+  acquireDataBus();
+  writeData(*bytes);
+
+  // DMA1 CH6 writes the next byte to GPIOB at the end of each cycle.
+  // Byte writes are duplicated on all lanes by the bus matrix, so the byte
+  // lands on PORTB[8:15], and also in the ODR bits of PORTB[0:7]. This flips
+  // their pulls during the transfer. waitDma restores them from hwDmaOdr.
+  DMA1_BASE->CCR6 = 0;
+  DMA1_BASE->CPAR6 = (uint32_t)&(GPIOB->regs->ODR);
+  DMA1_BASE->CMAR6 = (uint32_t)(inc ? &bytes[1] : bytes);
+  DMA1_BASE->CNDTR6 = count > 1 ? count - 1 : 0;
+  DMA1_BASE->CCR6 = DMA_CCR_PL_VERY_HIGH
+                    | DMA_CCR_MSIZE_8BITS
+                    | DMA_CCR_PSIZE_8BITS
+                    | (inc ? DMA_CCR_MINC : 0)
+                    | DMA_CCR_DIR
+                    | DMA_CCR_EN;
+  DMA_TIMER->CCR3 = ACSI_HW_DMA_CYCLE;
+
+  startHwDma(count);
 }
 
+void DmaPort::startHwDma(int count) {
+  // Debug output uses DMA1 CH4 too
+  Acsi::holdDbg();
+
+  // ACK starts the timer, which stops by itself after ACSI_HW_DMA_CYCLE ticks.
+  // The ACK filter set by the caller is kept.
+  DMA_TIMER->CR1 = TIMER_CR1_OPM;
+  DMA_TIMER->SMCR = (DMA_TIMER->SMCR & ~TIMER_SMCR_SMS) | TIMER_SMCR_SMS_TRIGGER;
+  DMA_TIMER->ARR = ACSI_HW_DMA_CYCLE;
+  DMA_TIMER->CNT = 0;
+  DMA_TIMER->CCR4 = 0; // Keep DRQ high for now
+  DMA_TIMER->SR = 0;
+
+  // DMA1 CH4 clears CCR4 on ACK: DRQ will stay high after the cycle.
+  // It also counts ACK pulses.
+  DMA1_BASE->CCR4 = 0;
+  DMA1_BASE->CPAR4 = (uint32_t)&(DMA_TIMER->CCR4);
+  DMA1_BASE->CMAR4 = (uint32_t)&hwDmaDrq[0];
+  DMA1_BASE->CNDTR4 = count;
+  DMA1_BASE->CCR4 = DMA_CCR_PL_HIGH
+                    | DMA_CCR_MSIZE_16BITS
+                    | DMA_CCR_PSIZE_16BITS
+                    | DMA_CCR_DIR
+                    | DMA_CCR_EN;
+
+  // DMA1 CH5 sets CCR4 back to 1 at the end of the cycle: DRQ goes low again.
+  // Only done count - 1 times so DRQ stays high after the last byte.
+  // CH5 is shared with A1 detection, which is disabled in the meantime.
+  CS_TIMER->DIER &= ~TIMER_DIER_CC3DE;
+  DMA1_BASE->CCR5 = 0;
+  DMA1_BASE->CPAR5 = (uint32_t)&(DMA_TIMER->CCR4);
+  DMA1_BASE->CMAR5 = (uint32_t)&hwDmaDrq[1];
+  DMA1_BASE->CNDTR5 = count > 1 ? count - 1 : 0;
+  DMA1_BASE->CCR5 = DMA_CCR_PL_HIGH
+                    | DMA_CCR_MSIZE_16BITS
+                    | DMA_CCR_PSIZE_16BITS
+                    | DMA_CCR_DIR
+                    | DMA_CCR_EN;
+
+  DMA1_BASE->IFCR = DMA_IFCR_CGIF4 | DMA_IFCR_CGIF5 | DMA_IFCR_CGIF6;
+  DMA_TIMER->DIER = TIMER_DIER_TDE | TIMER_DIER_UDE | TIMER_DIER_CC3DE;
+
+  // Enable DRQ output, transition through input pullup to avoid a glitch
+  GPIOA->regs->CRH = 0x84448BB4;
+  GPIOA->regs->CRH = 0x8444BBB4;
+
+  // Pull DRQ for the first byte
+  if(count > 0)
+    DMA_TIMER->CCR4 = 1;
+}
+
+const uint16_t DmaPort::hwDmaDrq[2] = { 0, 1 };
+uint8_t DmaPort::hwDmaFill;
+uint16_t DmaPort::hwDmaOdr;
+uint8_t *DmaPort::hwDmaReadBytes;
+int DmaPort::hwDmaReadCount;
+uint16_t DmaPort::hwDmaStage[hwDmaStageSize];
+#endif
+
+#if ACSI_PIO && ACSI_PIO_STREAM
+// Returns the GPIOB value for byte i of a stream.
+// Bytes past the end repeat the last byte.
+static uint16_t streamData(const uint8_t *bytes, uint8_t byte, int i, int count) {
+  if(bytes)
+    byte = bytes[i < count ? i : count - 1];
+  return ((uint16_t)byte) << 8;
+}
+
+void DmaPort::streamSend(const uint8_t *bytes, uint8_t byte, int count) {
+  // Fill the whole stream buffer
+  fillStream(0, bytes, byte, 0, count);
+  fillStream(1, bytes, byte, streamHalf, count);
+
+  // Output data
+  acquireDataBus();
+  writeData(bytes ? *bytes : byte);
+
+  startStream(true);
+  pullIrq();
+
+  // Release IRQ as soon as the first CS edge was seen
+  while(DMA1_BASE->CNDTR7 == streamSize)
+    checkStream();
+  releaseRq();
+
+  // Refill each half of the buffer while the DMA streams the other one
+  int half = 0;
+  int offset = 0;
+  for(; count - offset > streamHalf; offset += streamHalf) {
+    waitStreamHalf(half);
+    fillStream(half, bytes, byte, offset + 2 * streamHalf, count);
+    half ^= 1;
+  }
+  waitStreamEnd(half * streamHalf * 2 + (count - offset) * 2);
+
+  setupCsDma();
+
+  // Go back to the idle state
+  releaseDataBus();
+  waitIrqUp();
+  armA1();
+}
+
+void DmaPort::streamRead(uint8_t *bytes, int count) {
+  startStream(false);
+  pullIrq();
+
+  // Empty each half of the buffer while the DMA streams into the other one
+  int half = 0;
+  int offset = 0;
+  for(; count - offset > streamHalf; offset += streamHalf) {
+    waitStreamHalf(half);
+    readStream(half, &bytes[offset], streamHalf);
+    half ^= 1;
+  }
+  waitStreamEnd(half * streamHalf * 2 + (count - offset) * 2);
+  readStream(half, &bytes[offset], count - offset);
+
+  setupCsDma();
+
+  // Go back to the idle state
+  releaseRq();
+  waitIrqUp();
+  armA1();
+}
+
+void DmaPort::startStream(bool send) {
+  waitCsUp();
+
+  // Count both CS edges: each of them triggers a DMA1 CH7 transfer
+  CS_TIMER->CR1 &= ~(TIMER_CR1_OPM | TIMER_CR1_CEN);
+  CS_TIMER->CNT = 0;
+
+  DMA1_BASE->CCR7 &= ~DMA_CCR_EN;
+  if(send)
+    DMA1_BASE->CPAR7 = (uint32_t)&(GPIOB->regs->ODR);
+  else
+    DMA1_BASE->CPAR7 = (uint32_t)&(GPIOB->regs->IDR);
+  DMA1_BASE->CMAR7 = (uint32_t)streamBuf;
+  DMA1_BASE->CNDTR7 = streamSize;
+  DMA1_BASE->IFCR = DMA_IFCR_CGIF5 | DMA_IFCR_CGIF7;
+  DMA1_BASE->CCR7 = DMA_CCR_PL_VERY_HIGH
+                    | DMA_CCR_MSIZE_16BITS
+                    | DMA_CCR_PSIZE_16BITS
+                    | DMA_CCR_MINC
+                    | DMA_CCR_CIRC
+                    | (send ? DMA_CCR_DIR : 0)
+                    | DMA_CCR_EN;
+
+  CS_TIMER->CR1 |= TIMER_CR1_CEN;
+}
+
+void DmaPort::fillStream(int half, const uint8_t *bytes, uint8_t byte, int offset, int count) {
+  uint16_t *entry = &streamBuf[half * streamHalf * 2];
+  for(int i = offset; i < offset + streamHalf; ++i) {
+    // Keep the byte while CS is low, switch to the next one when CS goes up
+    *entry++ = streamData(bytes, byte, i, count);
+    *entry++ = streamData(bytes, byte, i + 1, count);
+  }
+}
+
+void DmaPort::readStream(int half, uint8_t *bytes, int count) {
+  // Data is sampled when CS goes low: keep only the first edge of each pulse
+  const uint16_t *entry = &streamBuf[half * streamHalf * 2];
+  for(int i = 0; i < count; ++i, entry += 2)
+    bytes[i] = *entry >> 8;
+}
+
+void DmaPort::waitStreamHalf(int half) {
+  resetTimeout();
+  if(half) {
+    while(!(DMA1_BASE->ISR & DMA_ISR_TCIF7))
+      checkStream();
+    DMA1_BASE->IFCR = DMA_IFCR_CTCIF7;
+  } else {
+    while(!(DMA1_BASE->ISR & DMA_ISR_HTIF7))
+      checkStream();
+    DMA1_BASE->IFCR = DMA_IFCR_CHTIF7;
+  }
+}
+
+void DmaPort::waitStreamEnd(int end) {
+  if(end == streamSize) {
+    waitStreamHalf(1);
+    return;
+  }
+
+  resetTimeout();
+  while((int)(streamSize - DMA1_BASE->CNDTR7) < end)
+    checkStream();
+}
+
+void DmaPort::checkStream() {
+  if(checkCommand())
+    // A1 pulses cannot be handled while streaming
+    quickReset();
+  checkReset();
+}
+
+uint16_t DmaPort::streamBuf[DmaPort::streamSize];
+#endif
+
 jmp_buf DmaPort::resetJump;
 
 void DmaPort::resetTimeout() {
@@ -848,6 +1319,11 @@ void DmaPort::setupCsTimer() {
   CS_TIMER->CCR4 = 0; // Receives PORTB on CS pulse
   CS_TIMER->EGR |= TIMER_EGR_UG; // Update the timer
 
+  setupA1Dma();
+  setupCsDma();
+}
+
+void DmaPort::setupA1Dma() {
   // Setup DMA to copy PORTB to CCR4 on CS+A1 pulse
   DMA1_BASE->CCR5 &= ~DMA_CCR_EN;
   DMA1_BASE->CPAR5 = (uint32_t)&(CS_TIMER->CCR4);
@@ -859,7 +1335,9 @@ void DmaPort::setupCsTimer() {
                     | DMA_CCR_CIRC
                     | DMA_CCR_DIR
                     | DMA_CCR_EN;
+}
 
+void DmaPort::setupCsDma() {
   // Setup DMA to copy PORTB to CCR4 on CS pulse
   DMA1_BASE->CCR7 &= ~DMA_CCR_EN;
   DMA1_BASE->CPAR7 = (uint32_t)&(CS_TIMER->CCR4);
@@ -927,6 +1405,12 @@ void DmaPort::quickReset() {
   // Disable DMA read
   disableDmaRead();
 
+#if ACSI_FAST_DMA == 6
+  // Stop hardware DMA
+  DMA1_BASE->CCR4 = 0;
+  Acsi::releaseDbg();
+#endif
+
   // Release all pins to neutral
   setupGpio();
 
@@ -934,7 +1418,9 @@ void DmaPort::quickReset() {
   delayMicroseconds(50);
 
   // Display a nice message
+  Trace::event(Trace::EVENT_QUICK_RESET, TIMEOUT_TIMER->CNT);
   Acsi::dbg("\n", TIMEOUT_TIMER->CNT, "\n--- Quick reset ---");
+  Acsi::syncDbg();
 
   // Jump back to the main loop
   longjmp(resetJump, 1);
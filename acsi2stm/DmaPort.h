@@ -62,6 +62,12 @@ struct DmaPort {
   // Read one byte using the IRQ/CS method.
   static uint8_t readIrq();
 
+  // Read command bytes using the IRQ/CS method.
+  // CS capture stays armed for the whole transfer, which reduces the latency
+  // between bytes. count must not exceed cmdMaxSize.
+  static void readCmdIrq(uint8_t *bytes, int count);
+  static const int cmdMaxSize = 16;
+
   // Send one byte using the IRQ/CS method.
   // This is normally used for the status byte.
   static void sendIrq(uint8_t byte);
@@ -90,6 +96,23 @@ struct DmaPort {
   // Fill memory with a byte value.
   static void fillDma(uint8_t byte, int count);
 
+#if ACSI_FAST_DMA == 6
+  // Start sending bytes using the hardware DMA engine and return immediately.
+  // The CPU is free until waitDma is called. Data must not be modified
+  // until then.
+  // WARNING: data must be in RAM, flash is not fast enough.
+  static void startSendDma(const uint8_t *bytes, int count);
+
+  // Start reading bytes using the hardware DMA engine and return immediately.
+  // The buffer is valid after waitDma returns.
+  // The buffer must be 16 bits aligned and have room for count * 2 bytes:
+  // each byte is received as a half word, then packed by waitDma.
+  static void startReadDma(uint8_t *bytes, int count);
+
+  // Wait until the hardware DMA transfer is finished and release the bus.
+  static void waitDma();
+#endif
+
   // Returns the device id for a given command byte.
   static uint8_t cmdDeviceId(uint8_t cmd) {
     return cmd >> 5;
@@ -132,6 +155,12 @@ protected:
   // Handles CS and CS+A1 cycles
   static void setupCsTimer();
 
+  // Setup DMA1 CH5 to copy PORTB to CS_TIMER CCR4 on each A1 pulse
+  static void setupA1Dma();
+
+  // Setup DMA1 CH7 to copy PORTB to CS_TIMER CCR4 on each CS pulse
+  static void setupCsDma();
+
   // Setup DMA_TIMER and its DMA channel
   // Handles DRQ/ACK cycles
   static void setupDrqTimer();
@@ -212,6 +241,69 @@ protected:
 
   // Release DATA pins output and switch them back to input mode
   static void releaseDataBus();
+
+#if ACSI_FAST_DMA == 6
+  // Values copied to DMA_TIMER CCR4 by DMA1 CH4 and CH5 to toggle DRQ
+  static const uint16_t hwDmaDrq[2];
+
+  // Byte value for fillDma
+  static uint8_t hwDmaFill;
+
+  // PORTB[0:7] output register (input pulls), restored after a transfer
+  static uint16_t hwDmaOdr;
+
+  // Buffer being read, packed by waitDma
+  static uint8_t *hwDmaReadBytes;
+  static int hwDmaReadCount;
+
+  // Receive buffer for readDma
+  static const int hwDmaStageSize = 256;
+  static uint16_t hwDmaStage[hwDmaStageSize];
+
+  // Setup the DMA engine to send count bytes from bytes.
+  // If inc is false, the same byte is sent count times.
+  static void startHwSend(const uint8_t *bytes, int count, bool inc);
+
+  // Switch DMA_TIMER to hardware DRQ/ACK cycles and pull DRQ
+  static void startHwDma(int count);
+#endif
+
+#if ACSI_PIO && ACSI_PIO_STREAM
+  // Number of bytes in each half of the stream buffer
+  static const int streamHalf = 32;
+
+  // Number of DMA transfers in the stream buffer.
+  // Each byte takes 2 transfers: one for each edge of the CS pulse.
+  static const int streamSize = streamHalf * 4;
+
+  // GPIOB values streamed on CS edges. Data is in the upper byte.
+  static uint16_t streamBuf[streamSize];
+
+  // Send bytes using DMA1 CH7 on CS edges.
+  // If bytes is null, repeat byte instead.
+  static void streamSend(const uint8_t *bytes, uint8_t byte, int count);
+
+  // Read bytes using DMA1 CH7 on CS edges.
+  static void streamRead(uint8_t *bytes, int count);
+
+  // Setup CS_TIMER and DMA1 CH7 to stream GPIOB from/to streamBuf
+  static void startStream(bool send);
+
+  // Fill half of the stream buffer with bytes starting at offset
+  static void fillStream(int half, const uint8_t *bytes, uint8_t byte, int offset, int count);
+
+  // Extract received bytes from half of the stream buffer
+  static void readStream(int half, uint8_t *bytes, int count);
+
+  // Wait until the DMA has finished transferring half of the stream buffer
+  static void waitStreamHalf(int half);
+
+  // Wait until the DMA has reached a position in the stream buffer
+  static void waitStreamEnd(int end);
+
+  // Check reset, timeout and A1 pulses while streaming
+  static void checkStream();
+#endif
 };
 
 // vim: ts=2 sw=2 sts=2 et
@@ -0,0 +1,138 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// FatFile internals are needed to set the current cluster, see TinyFile.cpp.
+// If the library changes too much, it's not guaranteed to work anymore.
+#define private public
+#include <SdFat.h>
+#undef private
+
+#include "FatCache.h"
+#include "BlockDev.h"
+
+#if ACSI_GEMDRIVE_FAT_CACHE && ! ACSI_STRICT
+bool FatCache::seek(SdDev &sd, FsFile &file, uint64_t position) {
+  FatFile *fatFile = file.m_fFile;
+  uint8_t fatType = sd.fs.fatType();
+
+  // Cases handled efficiently by SdFat
+  if(!fatFile
+      || (fatType != FAT_TYPE_FAT16 && fatType != FAT_TYPE_FAT32)
+      || !file.isFile()
+      || file.isContiguous()
+      || !position
+      || position > file.fileSize()
+      || position == file.curPosition())
+    return file.seek(position);
+
+  // Write the FAT sector cached by SdFat, if dirty
+  if(!file.sync())
+    return false;
+
+  // Walk the chain from the current cluster if possible, like SdFat does
+  uint32_t clusterSize = sd.fs.bytesPerCluster();
+  uint32_t target = ((uint32_t)position - 1) / clusterSize;
+  uint32_t cluster = fatFile->m_firstCluster;
+  uint32_t index = 0;
+  if(fatFile->m_curPosition && fatFile->m_curCluster) {
+    uint32_t current = (fatFile->m_curPosition - 1) / clusterSize;
+    if(current <= target) {
+      cluster = fatFile->m_curCluster;
+      index = current;
+    }
+  }
+
+  for(; index < target; ++index)
+    if(!next(sd, cluster))
+      return false;
+
+  fatFile->m_curCluster = cluster;
+  fatFile->m_curPosition = position;
+
+  return true;
+}
+
+void FatCache::invalidate(SdDev *sd) {
+  for(int i = 0; i < ACSI_GEMDRIVE_FAT_CACHE; ++i)
+    if(entries[i].sd == sd)
+      entries[i].sd = nullptr;
+}
+
+bool FatCache::next(SdDev &sd, uint32_t &cluster) {
+  // Entries are 4 bytes on FAT32, 2 bytes on FAT16
+  bool fat32 = sd.fs.fatType() == FAT_TYPE_FAT32;
+  uint32_t count = fat32 ? ACSI_BLOCKSIZE / 4 : ACSI_BLOCKSIZE / 2;
+
+  const uint8_t *sector = fetch(sd, sd.fs.fatStartSector() + cluster / count);
+  if(!sector)
+    return false;
+
+  uint32_t i = cluster % count;
+  uint32_t value;
+  if(fat32)
+    value = ((uint32_t)sector[i * 4]
+        | (uint32_t)sector[i * 4 + 1] << 8
+        | (uint32_t)sector[i * 4 + 2] << 16
+        | (uint32_t)sector[i * 4 + 3] << 24) & 0x0fffffff;
+  else
+    value = (uint32_t)sector[i * 2] | (uint32_t)sector[i * 2 + 1] << 8;
+
+  // Free cluster, bad cluster or end of chain
+  if(value < 2 || value > sd.fs.clusterCount() + 1)
+    return false;
+
+  cluster = value;
+  return true;
+}
+
+const uint8_t * FatCache::fetch(SdDev &sd, uint32_t sector) {
+  Entry *victim = &entries[0];
+  for(int i = 0; i < ACSI_GEMDRIVE_FAT_CACHE; ++i) {
+    Entry &entry = entries[i];
+    if(entry.sd == &sd && entry.sector == sector) {
+      ++hits;
+      entry.lastUse = ++useCounter;
+      return sectors[i];
+    }
+
+    // Prefer free entries, then the least recently used one
+    if(victim->sd && (!entry.sd || entry.lastUse < victim->lastUse))
+      victim = &entry;
+  }
+
+  ++misses;
+  uint8_t *data = sectors[victim - entries];
+  if(!sd.card.readSector(sector, data)) {
+    victim->sd = nullptr;
+    return nullptr;
+  }
+
+  victim->sd = &sd;
+  victim->sector = sector;
+  victim->lastUse = ++useCounter;
+
+  return data;
+}
+
+uint32_t FatCache::hits;
+uint32_t FatCache::misses;
+FatCache::Entry FatCache::entries[ACSI_GEMDRIVE_FAT_CACHE];
+uint8_t FatCache::sectors[ACSI_GEMDRIVE_FAT_CACHE][ACSI_BLOCKSIZE];
+uint32_t FatCache::useCounter;
+#endif
+
+// vim: ts=2 sw=2 sts=2 et
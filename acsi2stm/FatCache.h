@@ -0,0 +1,76 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FAT_CACHE_H
+#define FAT_CACHE_H
+
+#include "acsi2stm.h"
+#include "Devices.h"
+
+#include <SdFat.h>
+
+// Multi-sector FAT cache for GemDrive seeks.
+//
+// SdFat caches a single FAT sector, and GemDrive reopens files on each call,
+// so every Fread, Fwrite and Fseek walks the cluster chain from the beginning
+// of the file. On fragmented files this reloads FAT sectors over and over.
+//
+// This cache keeps the last ACSI_GEMDRIVE_FAT_CACHE FAT sectors read by seek,
+// evicting the least recently used one. SdFat still does all writes: the cache is
+// read-only and is invalidated whenever the FAT of a device changes.
+struct FatCache {
+#if ACSI_GEMDRIVE_FAT_CACHE && ! ACSI_STRICT
+  // Seek file to position, walking the cluster chain through the cache.
+  // Falls back to SdFat for exFAT, FAT12 and contiguous files.
+  static bool seek(SdDev &sd, FsFile &file, uint64_t position);
+
+  // Forget all cached sectors of a device
+  static void invalidate(SdDev *sd);
+
+  static uint32_t hits;
+  static uint32_t misses;
+
+protected:
+  // Get the next cluster in a chain. Returns false at the end of the chain
+  // or on error.
+  static bool next(SdDev &sd, uint32_t &cluster);
+
+  // Return a cached FAT sector, reading it if needed
+  static const uint8_t * fetch(SdDev &sd, uint32_t sector);
+
+  struct Entry {
+    SdDev *sd; // nullptr if the entry is free
+    uint32_t sector;
+    uint32_t lastUse;
+  };
+
+  static Entry entries[ACSI_GEMDRIVE_FAT_CACHE];
+  static uint8_t sectors[ACSI_GEMDRIVE_FAT_CACHE][ACSI_BLOCKSIZE];
+  static uint32_t useCounter;
+#else
+  static bool seek(SdDev &, FsFile &file, uint64_t position) {
+    return file.seek(position);
+  }
+  static void invalidate(SdDev *) {}
+
+  static const uint32_t hits = 0;
+  static const uint32_t misses = 0;
+#endif
+};
+
+// vim: ts=2 sw=2 sts=2 et
+#endif
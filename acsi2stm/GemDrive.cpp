@@ -17,8 +17,13 @@
 
 #include "GemDrive.h"
 
+#include "Counters.h"
 #include "DmaPort.h"
+#include "FatCache.h"
 #include "SysHook.h"
+#include "Profile.h"
+#include "Trace.h"
+#include "Trim.h"
 #if ACSI_PIO
 #include "FlashFirmware.h"
 #endif
@@ -570,6 +575,11 @@ bool GemPattern::attribMatching(uint8_t attrib, uint8_t fileAttrib) {
   return !fileAttrib || (attrib & fileAttrib);
 }
 
+// Each path level costs a 2 bytes index and a 4 bytes cluster, in curPath and
+// in every copy on the stack
+static_assert(sizeof(GemPath) <= sizeof(FsFile) + ACSI_GEMDRIVE_MAX_PATH * 6 + 16,
+              "GemPath is larger than expected");
+
 GemPath::GemPath(SdDev &sd_): sd(sd_), mediaId(0) {
   indexes[0] = 0;
 }
@@ -577,8 +587,10 @@ GemPath::GemPath(SdDev &sd_): sd(sd_), mediaId(0) {
 GemPath & GemPath::operator=(const GemPath &other) {
   close();
   int i;
-  for(i = 0; i < maxDepth && other.indexes[i]; ++i)
+  for(i = 0; i < maxDepth && other.indexes[i]; ++i) {
     indexes[i] = other.indexes[i];
+    clusters[i] = other.clusters[i];
+  }
   if(i < maxDepth)
     indexes[i] = 0;
 
@@ -604,6 +616,7 @@ bool GemPath::append(FsFile &f) {
     if(indexes[i] == 0) {
       // Append file's dirIndex
       indexes[i] = f.dirIndex() + 1;
+      clusters[i] = TinyFile::getCluster(f);
 
       // Terminate the index list
       if(i < maxDepth - 1)
@@ -626,6 +639,30 @@ bool GemPath::parent() {
   for(i = 1; i < maxDepth && indexes[i]; ++i);
   indexes[i - 1] = 0;
 
+  if(isRoot()) {
+    close();
+    openRoot(&sd.fs);
+    return true;
+  }
+
+  // On FAT, a folder handle only needs its first cluster to be read: inject
+  // the grandparent's cluster into a copy of the current handle, the same way
+  // TinyFile reopens parent folders, then open the parent from it.
+  // exFAT folders also need their length and contiguity: traverse from root.
+  if(isSubDir() && sd.fs.fatType() != FAT_TYPE_EXFAT) {
+    FsFile grandParent;
+    if(i < 3) {
+      grandParent.openRoot(&sd.fs);
+    } else {
+      grandParent = *this;
+      TinyFile::setCluster(grandParent, clusters[i - 3]);
+    }
+    close();
+    if(FsFile::open(&grandParent, (uint32_t)indexes[i - 2] - 1, O_RDONLY)
+       && isDir())
+      return true;
+  }
+
   // Traverse from root to open the parent
   close();
   FsFile f[2];
@@ -661,6 +698,8 @@ void GemPath::close() {
 }
 
 bool GemPath::openPath(const char *path, GemPattern &last, bool parseLastName) {
+  ACSI_PROFILE_ZONE(OPEN_PATH);
+
   if(*path == '\\') {
     ++path;
     clear();
@@ -849,23 +888,9 @@ bool GemPath::isContainedBy(FsFile &file) const {
 
   uint32_t fileCluster = TinyFile::getCluster(file);
 
-  FsFile f[2];
-  f[0].openRoot(&sd.fs);
-  f[1].openRoot(&sd.fs);
-  for(int i = 0; i < maxDepth && f[i & 1] && indexes[i]; ++i) {
-    // Point at next file
-    FsFile &from = f[i & 1];
-    FsFile &to = f[~i & 1];
-    to.open(&from, (uint32_t)indexes[i] - 1, O_RDONLY);
-
-    if(!to || !to.isDir()) {
-      // Invalid path
-      return false;
-    }
-
-    if(TinyFile::getCluster(to) == fileCluster)
+  for(int i = 0; i < maxDepth && indexes[i]; ++i)
+    if(clusters[i] == fileCluster)
       return true;
-  }
 
   return false;
 }
@@ -875,6 +900,11 @@ void GemFile::set(GemPath &parent, FsFile &file, oflag_t oflag_, Long basePage_)
   position = 0;
   basePage = basePage_;
   oflag = oflag_;
+
+  // Scan the cluster chain once to enable direct reads
+  fatChanges = GemDrive::getDrive(mediaId)->sd.fatChanges;
+  if(!file.contiguousRange(&firstSector, &lastSector))
+    firstSector = 0;
 }
 
 FsFile & GemFile::reopen() {
@@ -886,7 +916,7 @@ FsFile & GemFile::reopen() {
   open(drive->sd.fs, oflag);
   if(!lastFile)
     return lastFile;
-  if(!lastFile.seek(position))
+  if(!FatCache::seek(drive->sd, lastFile, position))
     close();
   return lastFile;
 }
@@ -896,6 +926,43 @@ int32_t GemFile::read(uint8_t *data, int32_t size) {
   if(!file)
     return -1;
 
+  SdDev &sd = GemDrive::getDrive(mediaId)->sd;
+  if(fatChanges != sd.fatChanges) {
+    // Clusters were allocated or freed since the last scan: this file may
+    // have been truncated, moved or fragmented by another handle
+    fatChanges = sd.fatChanges;
+    if(!file.contiguousRange(&firstSector, &lastSector))
+      firstSector = 0;
+  }
+
+  if(firstSector) {
+    uint32_t offset = position % ACSI_BLOCKSIZE;
+    uint64_t validLength = TinyFile::getValidLength(file);
+    uint32_t sector = firstSector + position / ACSI_BLOCKSIZE;
+    if(offset) {
+      // Read up to the next sector boundary through SdFat
+      if(size > (int32_t)(ACSI_BLOCKSIZE - offset))
+        size = ACSI_BLOCKSIZE - offset;
+    } else if(position < validLength && sector <= lastSector) {
+      // Read whole sectors directly from the SD card, within the written data
+      // and the sectors allocated to the file
+      uint64_t left = validLength - position;
+      uint32_t count = ((uint64_t)size < left ? size : left) / ACSI_BLOCKSIZE;
+      if(count > lastSector - sector + 1)
+        count = lastSector - sector + 1;
+      if(count) {
+        // Write data cached by SdFat, if dirty
+        if(!file.sync())
+          return -1;
+        if(!sd.card.readSectors(sector, data, count))
+          return -1;
+
+        position += count * ACSI_BLOCKSIZE;
+        return count * ACSI_BLOCKSIZE;
+      }
+    }
+  }
+
   int r = file.read(data, size);
   position = file.curPosition();
 
@@ -907,9 +974,17 @@ int32_t GemFile::write(uint8_t *data, int32_t size) {
   if(!file)
     return -1;
 
+  // Keep the free cluster count of Dfree up to date
+  SdDev &sd = GemDrive::getDrive(mediaId)->sd;
+  uint32_t clusters = sd.sizeToClusters(file.fileSize());
+
   int w = file.write(data, size);
   position = file.curPosition();
 
+  int32_t freed = (int32_t)clusters - (int32_t)sd.sizeToClusters(file.fileSize());
+  // New clusters may break contiguity: this also makes read() check it again
+  sd.adjustFreeClusters(freed);
+
   return w;
 }
 
@@ -918,17 +993,19 @@ int32_t GemFile::seek(int32_t offset, int whence) {
   if(!file)
     return -1;
 
+  SdDev &sd = GemDrive::getDrive(mediaId)->sd;
+
   switch(whence) {
     case 0:
-      if(!file.seek(offset))
+      if(!FatCache::seek(sd, file, offset))
         return -1;
       break;
     case 1:
-      if(!file.seek(position + offset))
+      if(!FatCache::seek(sd, file, position + offset))
         return -1;
       break;
     case 2:
-      if(!file.seek(file.fileSize() + offset))
+      if(!FatCache::seek(sd, file, file.fileSize() + offset))
         return -1;
       break;
     default:
@@ -1262,11 +1339,13 @@ void GemDrive::onInit(bool setBootDrive) {
 
 void GemDrive::onGemdos() {
   Word op = readWord();
+  GemdosCounter counter(op);
   switch(op) {
 #define DECLARE_CALLBACK(name) \
   case Tos::name ## _op: { name ## _p p; \
     dbg(#name "("); \
     readParams(&p, sizeof(p)); \
+    Trace::gemdos(op, &p, sizeof(p) > 1 ? sizeof(p) : 0); \
     dbg("):"); \
     on ## name(p); \
   } return
@@ -1303,12 +1382,15 @@ void GemDrive::onGemdos() {
   case Tos::name ## _op: { name ## _p p; \
     dbg(#name "("); \
     readParams(&p, sizeof(p)); \
+    Trace::gemdos(op, &p, sizeof(p) > 1 ? sizeof(p) : 0); \
     dbg("):"); \
   } break
 #else
 #undef DECLARE_CALLBACK
 #define DECLARE_CALLBACK(name) \
-  case Tos::name ## _op: break
+  case Tos::name ## _op: \
+    Trace::gemdos(op, nullptr, 0); \
+    break
 #endif
 
   DECLARE_CALLBACK(Cconin);
@@ -1336,6 +1418,7 @@ void GemDrive::onGemdos() {
 #undef DECLARE_CALLBACK
 
   default:
+    Trace::gemdos(op, nullptr, 0);
     dbgHex((uint32_t)op, ' ');
     break;
   }
@@ -1402,7 +1485,7 @@ bool GemDrive::onDfree(const Tos::Dfree_p &p) {
 
   uint32_t clsiz = volume.sectorsPerCluster();
   uint32_t total = volume.clusterCount();
-  uint32_t free = volume.freeClusterCount();
+  uint32_t free = sd.getFreeClusters();
 
   // Unsurprisingly, the ST can't really handle gigabytes, so we have to cap
   // these values. As long as there is more free space than what a ST operating
@@ -1466,9 +1549,14 @@ bool GemDrive::onDcreate(const Tos::Dcreate_p &p) {
   if(!name || name.isCurDir() || name.isParentDir())
     return rte(EPTHNF);
 
+  int32_t parentClusters = TinyFile::getClusterCount(drive->sd.fs, parent);
   if(!drive->sd.fs.mkdir(unicodeName, false))
     return rte(EACCDN);
 
+  // Account the cluster of the new folder and the growth of its parent
+  drive->sd.adjustFreeClusters(-1);
+  drive->sd.folderGrown(parent, parentClusters);
+
   return rte(E_OK);
 }
 
@@ -1496,9 +1584,17 @@ bool GemDrive::onDdelete(const Tos::Ddelete_p &p) {
     return rte(EPTHNF);
 
   dbg("-> ", unicodeName, ' ');
+  int32_t clusters = TinyFile::getClusterCount(drive->sd.fs, dir);
+  Trim::queue(drive->sd, dir);
   if(!drive->sd.fs.rmdir(unicodeName))
     return rte(EACCDN);
 
+  if(clusters > 0)
+    drive->sd.adjustFreeClusters(clusters);
+  else
+    // exFAT or read error: count free clusters again
+    drive->sd.startFreeClusterScan();
+
   return rte(E_OK);
 }
 
@@ -1560,16 +1656,27 @@ bool GemDrive::onFcreate(const Tos::Fcreate_p &p) {
     return rte(EACCDN);
 
   FsFile newFile;
-  if(!parent.openFile(name, newFile, O_TRUNC | O_RDWR)) {
+  if(parent.openFile(name, newFile, O_RDWR)) {
+    // Truncate the existing file and account freed clusters
+    uint32_t clusters = drive->sd.sizeToClusters(newFile.fileSize());
+    Trim::queue(drive->sd, newFile);
+    if(!newFile.truncate(0))
+      return rte(EACCDN);
+    drive->sd.adjustFreeClusters(clusters);
+  } else {
     const char *unicodeName = toUnicode(parent, name);
     if(!unicodeName)
       // Incompatible character
       return rte(EPTHNF);
 
     dbg("-> ", unicodeName, ' ');
+    int32_t parentClusters = TinyFile::getClusterCount(drive->sd.fs, parent);
     newFile = drive->sd.fs.open(unicodeName, O_CREAT | O_TRUNC | O_RDWR);
+    // The directory may have grown
+    FatCache::invalidate(&drive->sd);
     if(!newFile || newFile.isDir())
       return rte(EACCDN);
+    drive->sd.folderGrown(parent, parentClusters);
   }
 
   newFile.attrib(attrib);
@@ -1755,8 +1862,11 @@ bool GemDrive::onFdelete(const Tos::Fdelete_p &p) {
   if(!drive->sd.fs.exists(unicodeName))
     return rte(EFILNF);
 
+  uint32_t clusters = drive->sd.sizeToClusters(file.fileSize());
+  Trim::queue(drive->sd, file);
   if(!drive->sd.fs.remove(unicodeName))
     return rte(EACCDN);
+  drive->sd.adjustFreeClusters(clusters);
 
   return rte(E_OK);
 }
@@ -1976,8 +2086,13 @@ bool GemDrive::onFrename(const Tos::Frename_p &p) {
   dbg(" to -> ", unicodeName, ' ');
   if(toDrive->sd.fs.exists(unicodeName))
     return rte(EACCDN);
-  if(!from.rename(unicodeName))
+  int32_t toClusters = TinyFile::getClusterCount(toDrive->sd.fs, toParent);
+  bool renamed = from.rename(unicodeName);
+  // The target directory may have grown
+  FatCache::invalidate(&toDrive->sd);
+  if(!renamed)
     return rte(EACCDN);
+  toDrive->sd.folderGrown(toParent, toClusters);
 
   return rte(E_OK);
 }
@@ -2210,6 +2325,8 @@ void GemDrive::readParams(void *data, uint32_t size) {
 }
 
 uint32_t GemDrive::loadPrg(FsFile &prgFile, Long cmdline, Long env, uint32_t &basepage) {
+  ACSI_PROFILE_ZONE(LOAD_PRG);
+
 #if ACSI_DEBUG
   char *name = (char *)buf;
   prgFile.getName(name, sizeof(buf));
@@ -2275,11 +2392,21 @@ uint32_t GemDrive::loadPrg(FsFile &prgFile, Long cmdline, Long env, uint32_t &ba
   uint32_t prgSize = ph.ph_tlen + ph.ph_dlen;
   uint32_t prgOffset = 0;
   int block;
+  int carry = 0; // Bytes of a straddling relocation kept for the next chunk
   FsFile relFile = prgFile;
   int relTableIndex = 0;
   int relTableSize = 0;
   int relOffset = -1; // means "no relocation"
 
+#if ACSI_FAST_DMA == 6 && ! ACSI_PIO && ACSI_BLOCKS >= 2
+  // Relocate the next chunk in one half of buf while the other half is sent
+  static const int chunkSize = bufSize / 2;
+  bool sending = false;
+#else
+  static const int chunkSize = bufSize;
+#endif
+  uint8_t *chunk = buf;
+
   if(!ph.ph_absflag) {
     // Load reloction offset
     Long ro;
@@ -2294,36 +2421,38 @@ uint32_t GemDrive::loadPrg(FsFile &prgFile, Long cmdline, Long env, uint32_t &ba
   if(relOffset >= 0)
     verbose("Relocations:\n");
 
-  do {
-    // Read program block
-    block = (prgSize - prgOffset > sizeof(buf)) ? sizeof(buf) : prgSize - prgOffset;
-    block = prgFile.read(buf, block);
-    if(block < 0)
+  while(prgOffset < prgSize) {
+    // Read program chunk after the bytes carried over from the previous one
+    block = (prgSize - prgOffset > chunkSize) ? chunkSize : prgSize - prgOffset;
+    int readBytes = prgFile.read(&chunk[carry], block - carry);
+    if(readBytes <= 0)
       goto relocationFailed;
-    if(!block)
-      break;
+    block = carry + readBytes;
+
+    // Number of bytes to send. Excludes a relocation that straddles the end of
+    // the chunk.
+    int send = block;
 
     if(relOffset >= 0) {
-      // Relocate block
+      // Relocate chunk
       while(relOffset < block) {
-        // Relocation offset is inside the currrent block
+        // Relocation offset is inside the currrent chunk
 
         if(relOffset + 4 > block) {
-          // No luck: the address is in the middle of the loading block.
-          // Just shift block size and resume relocation at next iteration.
-          int shift = block - relOffset;
-          if(!prgFile.seekCur(-shift))
+          // No luck: the address is in the middle of the loading chunk.
+          // Keep the partial value and finish it with the next chunk.
+          if(prgOffset + block >= prgSize)
             goto relocationFailed;
-          block = relOffset;
+          send = relOffset;
           break;
         }
 
         // Apply current relocation vector
-        ToLong value(&buf[relOffset]);
+        ToLong value(&chunk[relOffset]);
         verboseHex("Patch ", relOffset + prgOffset, ": ", (uint32_t)value);
         value += prgStart;
         verboseHex(" -> ", (uint32_t)value, '\n');
-        value.set(&buf[relOffset]);
+        value.set(&chunk[relOffset]);
 
         // Load more relocation info if needed
 loadRelocationInfo:
@@ -2357,24 +2486,49 @@ loadRelocationInfo:
         relOffset += relTableCache[relTableIndex];
         ++relTableIndex;
       }
-      relOffset -= block;
+      relOffset -= send;
     }
 
-    sendAt(prgPtr, buf, block);
+#if ACSI_FAST_DMA == 6 && ! ACSI_PIO && ACSI_BLOCKS >= 2
+    // Send this chunk in the background and switch to the other half
+    if(sending)
+      DmaPort::waitDma();
+    sending = startSendAt(prgPtr, chunk, send);
+    uint8_t *next = chunk == buf ? &buf[chunkSize] : buf;
+#else
+    sendAt(prgPtr, chunk, send);
+    uint8_t *next = chunk;
+#endif
+
+    // Move the straddling relocation to the beginning of the next chunk
+    carry = block - send;
+    memmove(next, &chunk[send], carry);
+    chunk = next;
 
-    prgPtr += block;
-    prgOffset += block;
-  } while(block > 0);
+    prgPtr += send;
+    prgOffset += send;
+  }
+
+#if ACSI_FAST_DMA == 6 && ! ACSI_PIO && ACSI_BLOCKS >= 2
+  if(sending)
+    DmaPort::waitDma();
+#endif
 
   return E_OK;
 
 relocationFailed:
+#if ACSI_FAST_DMA == 6 && ! ACSI_PIO && ACSI_BLOCKS >= 2
+  if(sending)
+    DmaPort::waitDma();
+#endif
   verbose("Reloc failed\n");
   Mfree(basepage);
   return EPLFMT;
 }
 
 bool GemDrive::scanDTA(GemDriveDTA &dta, uint32_t noFileErr) {
+  ACSI_PROFILE_ZONE(SCAN_DTA);
+
   GemPattern fileName;
 
   do {
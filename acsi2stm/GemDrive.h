@@ -139,6 +139,7 @@ struct GemPath: public FsFile {
 protected:
   static const int maxDepth = ACSI_GEMDRIVE_MAX_PATH;
   uint16_t indexes[maxDepth];
+  uint32_t clusters[maxDepth]; // First cluster of each folder in indexes
   SdDev &sd;
 public:
   uint32_t mediaId;
@@ -156,6 +157,9 @@ struct GemFile: public TinyFile {
   bool isWritable() const;
 
   uint32_t position; // Current seek position
+  uint32_t firstSector; // First SD sector if the file is contiguous, else 0
+  uint32_t lastSector; // Last SD sector allocated to a contiguous file
+  uint32_t fatChanges; // SdDev::fatChanges when the sectors were computed
   Long basePage;
   oflag_t oflag;
 };
@@ -0,0 +1,72 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Idle.h"
+#include "DmaPort.h"
+#include "Monitor.h"
+#include "Profile.h"
+
+void Idle::add(Task task, Priority priority, uint32_t period) {
+  if(taskCount >= maxTasks) {
+    Monitor::dbg("Too many idle tasks\n");
+    return;
+  }
+
+  // Insert after all tasks of the same priority
+  int i;
+  for(i = taskCount; i > 0 && tasks[i - 1].priority > priority; --i)
+    tasks[i] = tasks[i - 1];
+
+  tasks[i].task = task;
+  tasks[i].priority = priority;
+  tasks[i].period = period;
+  tasks[i].lastRun = millis();
+  ++taskCount;
+}
+
+void Idle::run() {
+  sliceStart = micros();
+
+  // Overdue tasks first
+  uint32_t now = millis();
+  for(int i = 0; i < taskCount && !expired(); ++i) {
+    Entry &entry = tasks[i];
+    if(entry.period && now - entry.lastRun > entry.period)
+      call(entry);
+  }
+
+  // Restart from the highest priority each time a task did some work
+  for(int i = 0; i < taskCount && !expired(); ++i)
+    if(call(tasks[i]))
+      i = -1;
+}
+
+bool Idle::expired() {
+  return DmaPort::checkCommand() || micros() - sliceStart >= sliceBudget;
+}
+
+bool Idle::call(Entry &entry) {
+  ACSI_PROFILE_ZONE(IDLE_TASK);
+  entry.lastRun = millis();
+  return entry.task();
+}
+
+Idle::Entry Idle::tasks[maxTasks];
+int Idle::taskCount = 0;
+uint32_t Idle::sliceStart;
+
+// vim: ts=2 sw=2 sts=2 et
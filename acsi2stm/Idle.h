@@ -0,0 +1,76 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IDLE_H
+#define IDLE_H
+
+#include "acsi2stm.h"
+
+// Cooperative scheduler for background work done while waiting for a command.
+//
+// Tasks do a small, bounded amount of work per call. DmaPort::waitCommand
+// calls run() in its wait loop. run() calls tasks until a command arrives or
+// the slice budget is spent. Tasks that loop check expired() to stop early.
+//
+// Tasks are tried in priority order, starting over each time one did some
+// work. A task with a period is called first if it was not called for longer
+// than its period, so busy higher priority tasks can't starve it.
+//
+// With ACSI_PROFILE, the IDLE_TASK zone measures each task call. Its maximum
+// is the worst-case latency added to command pickup.
+struct Idle {
+  // Task function. Returns true if it did some work.
+  typedef bool (*Task)();
+
+  enum Priority {
+    HIGH,
+    NORMAL,
+    LOW,
+  };
+
+  // Register a task. Period is in milliseconds, 0 if the task has no deadline.
+  static void add(Task task, Priority priority, uint32_t period = 0);
+
+  // Run tasks for one time slice
+  static void run();
+
+  // Returns true if the current task must return: a command is waiting or
+  // the slice budget is spent.
+  static bool expired();
+
+  // Time slice budget in microseconds
+  static const uint32_t sliceBudget = 1000;
+
+protected:
+  struct Entry {
+    Task task;
+    Priority priority;
+    uint32_t period;
+    uint32_t lastRun; // Time of the last call in milliseconds
+  };
+
+  // Call a task and account for its time
+  static bool call(Entry &entry);
+
+  static const int maxTasks = 8;
+  static Entry tasks[maxTasks]; // Sorted by priority
+  static int taskCount;
+  static uint32_t sliceStart; // Start of the current slice in microseconds
+};
+
+// vim: ts=2 sw=2 sts=2 et
+#endif
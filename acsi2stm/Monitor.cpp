@@ -0,0 +1,137 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Monitor.h"
+
+#if ACSI_DEBUG && ACSI_SERIAL_DMA
+#include <libmaple/dma.h>
+#include <libmaple/usart.h>
+
+size_t DbgRing::write(uint8_t c) {
+  if(dropped && room() >= 32) {
+    // Report lost data as soon as there is room again
+    uint32_t lost = dropped;
+    dropped = 0;
+    print("\n[");
+    print(lost);
+    print(" bytes dropped]\n");
+  }
+
+  while(!room()) {
+#if ACSI_SERIAL_DMA_BLOCK
+    if(!held) {
+      kick();
+      continue;
+    }
+#endif
+    ++dropped;
+    return 0;
+  }
+
+  ring[head] = c;
+  head = (head + 1) % size;
+  return 1;
+}
+
+void DbgRing::begin() {
+  RCC_BASE->AHBENR |= RCC_AHBENR_DMA1EN;
+  DMA1_BASE->CCR4 = 0;
+  USART1_BASE->CR3 |= USART_CR3_DMAT;
+}
+
+void DbgRing::kick() {
+  if(held)
+    return;
+
+  if(sending) {
+    if(DMA1_BASE->CNDTR4)
+      return;
+
+    // Previous transfer finished
+    DMA1_BASE->CCR4 = 0;
+    tail = (tail + sending) % size;
+    sending = 0;
+  }
+
+  if(head == tail)
+    return;
+
+  // Send up to the end of the buffer. The rest is sent by the next kick.
+  sending = (head > tail ? head : size) - tail;
+
+  DMA1_BASE->CPAR4 = (uint32_t)&(USART1_BASE->DR);
+  DMA1_BASE->CMAR4 = (uint32_t)&ring[tail];
+  DMA1_BASE->CNDTR4 = sending;
+  DMA1_BASE->CCR4 =
+      DMA_CCR_PL_LOW
+    | DMA_CCR_MSIZE_8BITS
+    | DMA_CCR_PSIZE_8BITS
+    | DMA_CCR_MINC
+    | DMA_CCR_DIR
+    | DMA_CCR_EN
+    ;
+}
+
+void DbgRing::sync() {
+  if(held)
+    return;
+
+  while(head != tail)
+    kick();
+
+  // Wait until the last byte has left the shift register
+  while(!(USART1_BASE->SR & USART_SR_TC));
+}
+
+void DbgRing::hold() {
+  if(held)
+    return;
+
+  // Stop the transfer where it is. The rest is sent after release.
+  DMA1_BASE->CCR4 = 0;
+  USART1_BASE->CR3 &= ~USART_CR3_DMAT;
+  if(sending) {
+    tail = (tail + sending - DMA1_BASE->CNDTR4) % size;
+    sending = 0;
+  }
+  held = true;
+}
+
+void DbgRing::release() {
+  if(!held)
+    return;
+
+  held = false;
+  DMA1_BASE->CCR4 = 0;
+  USART1_BASE->CR3 |= USART_CR3_DMAT;
+  kick();
+}
+
+int DbgRing::room() {
+  return (tail + size - head - 1) % size;
+}
+
+uint8_t DbgRing::ring[DbgRing::size];
+int DbgRing::head = 0;
+int DbgRing::tail = 0;
+int DbgRing::sending = 0;
+uint32_t DbgRing::dropped = 0;
+bool DbgRing::held = false;
+DbgRing Monitor::dbgRing;
+#endif
+
+// vim: ts=2 sw=2 sts=2 et
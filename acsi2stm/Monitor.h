@@ -20,6 +20,40 @@
 
 #include "acsi2stm.h"
 
+#if ACSI_DEBUG && ACSI_SERIAL_DMA
+// Debug output ring buffer, sent to USART1 by DMA1 CH4 in the background.
+// DMA1 CH4 is shared with the hardware DMA engine of ACSI_FAST_DMA 6: use
+// hold and release around its transfers.
+struct DbgRing: public Print {
+  virtual size_t write(uint8_t c);
+
+  // Enable USART1 TX DMA requests
+  static void begin();
+
+  // Start sending pending data if the previous DMA transfer has finished
+  static void kick();
+
+  // Wait until all pending data was sent on the serial port
+  static void sync();
+
+  // Stop using DMA1 CH4 at once, until release is called. Data not sent yet
+  // and data printed in the meantime are kept in the buffer or dropped.
+  static void hold();
+  static void release();
+
+  // Number of free bytes in the buffer
+  static int room();
+
+  static const int size = ACSI_SERIAL_DMA;
+  static uint8_t ring[size];
+  static int head;
+  static int tail;
+  static int sending; // Bytes being sent by the current DMA transfer
+  static uint32_t dropped;
+  static bool held;
+};
+#endif
+
 // Monitoring functions
 class Monitor {
 public:
@@ -48,26 +82,79 @@ public:
   }
 #endif
 
+// Cycle counter
+
+  // Enable the Cortex-M3 DWT cycle counter
+  static void beginCycles() {
+    *(volatile uint32_t *)0xE000EDFC |= 1 << 24; // DEMCR: TRCENA
+    *(volatile uint32_t *)0xE0001004 = 0; // DWT_CYCCNT
+    *(volatile uint32_t *)0xE0001000 |= 1; // DWT_CTRL: CYCCNTENA
+  }
+
+  // Return the number of CPU cycles since beginCycles. Wraps around.
+  static uint32_t cycles() {
+    return *(volatile uint32_t *)0xE0001004; // DWT_CYCCNT
+  }
+
 // Debug output functions
 
   static void beginDbg(int speed = ACSI_SERIAL_SPEED) {
 #if ACSI_DEBUG
     ACSI_SERIAL.begin(speed);
+#if ACSI_SERIAL_DMA
+    DbgRing::begin();
+#endif
 #else
     (void)speed;
 #endif
   }
 
+  // Push printed text to the serial port.
+  // Doesn't wait if ACSI_SERIAL_DMA is enabled.
   static void flushDbg() {
-#if ACSI_DEBUG
+#if ACSI_DEBUG && ACSI_SERIAL_DMA
+    DbgRing::kick();
+#elif ACSI_DEBUG
     ACSI_SERIAL.flush();
 #endif
   }
 
+  // Wait until all printed text is actually sent
+  static void syncDbg() {
+#if ACSI_DEBUG && ACSI_SERIAL_DMA
+    DbgRing::sync();
+#elif ACSI_DEBUG
+    ACSI_SERIAL.flush();
+#endif
+  }
+
+  // Stop and resume using DMA1 CH4 for debug output
+  static void holdDbg() {
+#if ACSI_DEBUG && ACSI_SERIAL_DMA
+    DbgRing::hold();
+#endif
+  }
+  static void releaseDbg() {
+#if ACSI_DEBUG && ACSI_SERIAL_DMA
+    DbgRing::release();
+#endif
+  }
+
+#if ACSI_DEBUG
+  // Stream used for debug output
+  static Print & dbgOut() {
+#if ACSI_SERIAL_DMA
+    return dbgRing;
+#else
+    return ACSI_SERIAL;
+#endif
+  }
+#endif
+
   template<typename T>
   static void dbg(T txt) {
 #if ACSI_DEBUG
-    ACSI_SERIAL.print(txt);
+    dbgOut().print(txt);
     flushDbg();
 #else
     (void)txt;
@@ -96,7 +183,7 @@ public:
   template<typename T>
   static void dbgHex(T txt) {
 #if ACSI_DEBUG
-    ACSI_SERIAL.print(txt, HEX);
+    dbgOut().print(txt, HEX);
     flushDbg();
 #else
     (void)txt;
@@ -191,6 +278,11 @@ public:
     (void)maxSize;
 #endif
   }
+
+protected:
+#if ACSI_DEBUG && ACSI_SERIAL_DMA
+  static DbgRing dbgRing;
+#endif
 };
 
 #endif
@@ -0,0 +1,65 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Profile.h"
+#include "SysHook.h"
+
+#if ACSI_PROFILE
+void Profile::reset() {
+  for(int z = 0; z < ZONE_COUNT; ++z)
+    stats[z] = Stats();
+}
+
+int Profile::write(uint8_t *bytes) {
+  uint8_t *p = bytes;
+  for(int z = 0; z < ZONE_COUNT; ++z) {
+    ToLong(stats[z].calls).set(&p[0]);
+    ToLong((uint32_t)(stats[z].total >> 32)).set(&p[4]);
+    ToLong((uint32_t)stats[z].total).set(&p[8]);
+    ToLong(stats[z].max).set(&p[12]);
+    p += 16;
+  }
+  return p - bytes;
+}
+
+void Profile::dump() {
+  Monitor::dbg("\nProfile: calls, total us, max us\n");
+  for(int z = 0; z < ZONE_COUNT; ++z) {
+    const Stats &s = stats[z];
+    Monitor::dbg(zoneNames[z], ": ", s.calls, ", ",
+                 (uint32_t)(s.total / CYCLES_PER_MICROSECOND), ", ",
+                 s.max / CYCLES_PER_MICROSECOND, '\n');
+  }
+}
+
+const char * const Profile::zoneNames[ZONE_COUNT] = {
+  "waitCommand",
+  "readCmdBuf",
+  "sdRead",
+  "sdWrite",
+  "sendDma",
+  "readDma",
+  "openPath",
+  "scanDTA",
+  "loadPrg",
+  "idleTask",
+};
+
+Profile::Stats Profile::stats[ZONE_COUNT];
+#endif
+
+// vim: ts=2 sw=2 sts=2 et
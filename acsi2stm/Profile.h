@@ -0,0 +1,106 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "acsi2stm.h"
+#include "Monitor.h"
+
+// Profiling zones based on the DWT cycle counter.
+//
+// Put ACSI_PROFILE_ZONE(name) at the beginning of a block to measure the time
+// spent in it. Zones compile to nothing if ACSI_PROFILE is disabled.
+//
+// Statistics are read by the ST with the "ACSIPrfRd" vendor command, and
+// printed on the serial port in debug mode.
+struct Profile {
+  enum Zone {
+    WAIT_COMMAND,
+    READ_CMD,
+    SD_READ,
+    SD_WRITE,
+    SEND_DMA,
+    READ_DMA,
+    OPEN_PATH,
+    SCAN_DTA,
+    LOAD_PRG,
+    IDLE_TASK,
+    ZONE_COUNT
+  };
+
+  struct Stats {
+    uint32_t calls;
+    uint64_t total; // Total cycles
+    uint32_t max; // Maximum cycles of a single call
+
+    void add(uint32_t cycles) {
+      ++calls;
+      total += cycles;
+      if(cycles > max)
+        max = cycles;
+    }
+  };
+
+#if ACSI_PROFILE
+  // Setup the cycle counter
+  static void begin() {
+    Monitor::beginCycles();
+  }
+
+  // Account time for a zone
+  static void add(Zone zone, uint32_t cycles) {
+    stats[zone].add(cycles);
+  }
+
+  // Clear all statistics
+  static void reset();
+
+  // Write statistics as big endian values: for each zone, calls (Long),
+  // total cycles (2 Longs, high first) and max cycles (Long).
+  // Returns the number of bytes written.
+  static int write(uint8_t *bytes);
+
+  // Print the statistics table on the debug output
+  static void dump();
+
+  static const char * const zoneNames[ZONE_COUNT];
+  static Stats stats[ZONE_COUNT];
+#else
+  static void begin() {}
+#endif
+};
+
+#if ACSI_PROFILE
+// Measure the time between construction and destruction
+struct ProfileScope {
+  ProfileScope(Profile::Zone zone_): zone(zone_), start(Monitor::cycles()) {}
+  ~ProfileScope() {
+    Profile::add(zone, Monitor::cycles() - start);
+  }
+
+  Profile::Zone zone;
+  uint32_t start;
+};
+
+#define ACSI_PROFILE_ZONE(name) ProfileScope profileScope(Profile::name)
+#else
+#define ACSI_PROFILE_ZONE(name) do {} while(0)
+#endif
+
+// vim: ts=2 sw=2 sts=2 et
+#endif
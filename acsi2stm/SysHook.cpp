@@ -16,6 +16,8 @@
  */
 
 #include "SysHook.h"
+#include "Counters.h"
+#include "Trace.h"
 
 Long SysHook::stackAlloc(int bytes)
 {
@@ -90,6 +92,43 @@ void SysHook::sendAt(uint32_t address, const uint8_t *bytes, int count)
 #endif
 }
 
+#if ACSI_FAST_DMA == 6 && ! ACSI_PIO
+bool SysHook::startSendAt(uint32_t address, const uint8_t *bytes, int count)
+{
+  if(count < 32 || !isDma(address + count - 1)) {
+    // Too small or not reachable by DMA: use the normal method
+    sendAt(address, bytes, count);
+    return false;
+  }
+
+  if(address & 1) {
+    // Unaligned access: write the first byte indirectly
+    sendAt(address, bytes, 1);
+    ++address;
+    ++bytes;
+    --count;
+  }
+
+  // Write the unaligned end first, so the DMA transfer comes last
+  int tail = count & 0xf;
+  count -= tail;
+  sendAt(address + count, bytes + count, tail);
+
+  while(count > 0x1fff0) {
+    setDmaRead(address);
+    sendDma(bytes, 0x1fff0);
+
+    address += 0x1fff0;
+    bytes += 0x1fff0;
+    count -= 0x1fff0;
+  }
+
+  setDmaRead(address);
+  DmaPort::startSendDma(bytes, count);
+  return true;
+}
+#endif
+
 void SysHook::readAt(uint8_t *bytes, uint32_t source, int count)
 {
   if(count <= 0)
@@ -216,7 +255,7 @@ void SysHook::clearAt(uint32_t bytes, uint32_t address) {
     sendAt(address, blank, bytes);
 #else
   setDmaRead(address);
-  sendCommandNoWait(0x99, bytes);
+  startPioCopy(0x99, bytes);
   DmaPort::repeatIrqFast(0, bytes);
 #endif
 }
@@ -226,7 +265,7 @@ void SysHook::readDma(uint8_t *bytes, int count)
   if(!count)
     return;
 #if ACSI_PIO
-  sendCommandNoWait(0x98, count);
+  startPioCopy(0x98, count);
   DmaPort::readIrqFast(bytes, count);
 #else
   DmaPort::readDma(bytes, count);
@@ -239,7 +278,7 @@ void SysHook::readDmaString(char *bytes, int count)
     return;
 #if ACSI_PIO
   for(int i = 0; i < count; ++i) {
-    sendCommandNoWait(0x98, 1);
+    startPioCopy(0x98, 1);
     DmaPort::readIrqFast((uint8_t *)&bytes[i], 1);
     if(!bytes[i])
       return;
@@ -254,7 +293,7 @@ void SysHook::sendDma(const uint8_t *bytes, int count)
   if(!count)
     return;
 #if ACSI_PIO
-  sendCommandNoWait(0x99, count);
+  startPioCopy(0x99, count);
   DmaPort::sendIrqFast(bytes, count);
 #else
   DmaPort::sendDma(bytes, count);
@@ -369,11 +408,14 @@ end_of_string:
 void SysHook::rte(int8_t value) {
   if(value <= (int8_t)0x9a)
     rte(ToLong(value));
+  else
+    Trace::gemdosRte((uint32_t)(int32_t)value);
   dbgHex("rte(", (uint32_t)(uint8_t)value, ") ");
   DmaPort::sendIrq(value);
 }
 
 void SysHook::forward() {
+  Trace::gemdosForward();
   dbg("forward ");
   DmaPort::sendIrq(0x9a);
 }
@@ -435,6 +477,7 @@ void SysHook::copyToStack(ToLong address)
 }
 
 void SysHook::rte(ToLong value) {
+  Trace::gemdosRte(value);
   dbgHex("rte(", (uint32_t)value, ") ");
   sendCommandNoWait(0x80, value);
 }
@@ -447,6 +490,7 @@ void SysHook::waitCommand() {
 
 void SysHook::sendCommand(int command, ToLong param)
 {
+  Counters::sysHook();
   sendCommandNoWait(command, param);
   waitCommand();
 }
@@ -459,6 +503,7 @@ void SysHook::sendCommandNoWait(int command, ToLong param)
   bytes[2] = param.bytes[1];
   bytes[3] = param.bytes[2];
   bytes[4] = param.bytes[3];
+  Trace::sysHookCommand();
   DmaPort::sendIrqFast(bytes, 5);
 }
 
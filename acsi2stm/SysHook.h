@@ -243,6 +243,14 @@ struct SysHook: public Monitor {
     sendAt(target, (const uint8_t *)&value, sizeof(T));
   }
 
+#if ACSI_FAST_DMA == 6 && ! ACSI_PIO
+  // Start copying data to a target address.
+  // Returns true if the end of the transfer is still running in the
+  // background. In that case, call DmaPort::waitDma before any other bus
+  // access, and don't modify data until then.
+  static bool startSendAt(uint32_t address, const uint8_t *bytes, int count);
+#endif
+
   // Read bytes from a source address
   static void readAt(uint8_t *bytes, uint32_t source, int count);
 
@@ -375,6 +383,18 @@ struct SysHook: public Monitor {
   // Send a command without waiting for completion
   static void sendCommandNoWait(int command, ToLong param);
 
+#if ACSI_PIO
+  // Start a PIO copy (command 0x98 or 0x99) of count bytes
+  static void startPioCopy(int command, int count) {
+#if ACSI_PIO_STREAM
+    sendCommandNoWait(command, count);
+#else
+    // Bit 31 asks the driver for its slower loop, paced for CPU polling
+    sendCommandNoWait(command, 0x80000000 | count);
+#endif
+  }
+#endif
+
   // Test for DMA-compatible memory
   static bool isDma(uint32_t address) {
 #if ACSI_PIO
@@ -119,6 +119,13 @@ void TinyFile::close() {
   closeLast();
 }
 
+bool TinyFile::syncVolume(FsVolume &volume) {
+  if(!volume.m_fVol)
+    // exFAT
+    return true;
+  return volume.m_fVol->cacheSync();
+}
+
 uint32_t TinyFile::getCluster(FsFile &file) {
   if(!file.isSubDir() && file.isDir())
     // Root directory
@@ -144,6 +151,38 @@ void TinyFile::setCluster(FsFile &file, uint32_t cluster) {
     file.m_xFile->m_firstCluster = cluster;
 }
 
+int32_t TinyFile::getClusterCount(FsVolume &volume, FsFile &folder) {
+  FatVolume *fat = volume.m_fVol;
+  if(!fat || !folder.isDir())
+    return -1;
+
+  uint32_t cluster = getCluster(folder);
+  if(!cluster) {
+    if(fat->fatType() != FAT_TYPE_FAT32)
+      // FAT16 root folder: fixed size
+      return 0;
+    cluster = fat->rootDirStart();
+  }
+
+  for(int32_t count = 1; count <= (int32_t)fat->clusterCount(); ++count) {
+    int8_t status = fat->fatGet(cluster, &cluster);
+    if(status < 0)
+      return -1;
+    if(!status)
+      // End of chain
+      return count;
+  }
+
+  // Corrupted chain
+  return -1;
+}
+
+uint64_t TinyFile::getValidLength(FsFile &file) {
+  if(file.m_xFile)
+    return file.m_xFile->m_validLength;
+  return file.fileSize();
+}
+
 void TinyFile::closeLast() {
   lastFile.close();
   lastParent.close();
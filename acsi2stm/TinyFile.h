@@ -62,6 +62,18 @@ struct __attribute__((__packed__)) TinyFile {
   static uint32_t getCluster(FsFile &file);
   static void setCluster(FsFile &file, uint32_t cluster);
 
+  // Return the number of clusters of a FAT16 or FAT32 folder by following its
+  // cluster chain. Returns 0 for a FAT16 root folder, -1 on exFAT or on error.
+  static int32_t getClusterCount(FsVolume &volume, FsFile &folder);
+
+  // Return the length of the data written to a file. On exFAT, this is the
+  // ValidDataLength: clusters may be allocated past it.
+  static uint64_t getValidLength(FsFile &file);
+
+  // Write the sectors cached by SdFat for a FAT volume, so that direct SD
+  // card reads see them
+  static bool syncVolume(FsVolume &volume);
+
   uint32_t mediaId;
   uint32_t dirCluster;
   uint16_t index;
@@ -0,0 +1,160 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Trace.h"
+#include "SysHook.h"
+
+#if ACSI_TRACE
+void Trace::record(uint8_t type, const void *data, int size,
+                   const void *extra, int extraSize) {
+  if(dropped) {
+    if(room() < 6 + 2) {
+      ++dropped;
+      return;
+    }
+    pushHeader(DROPPED, 2);
+    push(dropped >> 8);
+    push(dropped);
+    dropped = 0;
+  }
+
+  if(room() < 6 + size + extraSize) {
+    ++dropped;
+    return;
+  }
+
+  pushHeader(type, size + extraSize);
+  for(int i = 0; i < size; ++i)
+    push(((const uint8_t *)data)[i]);
+  for(int i = 0; i < extraSize; ++i)
+    push(((const uint8_t *)extra)[i]);
+}
+
+bool Trace::drain() {
+  if(stReader)
+    return false;
+
+  bool sent = false;
+  while(head != tail && ACSI_SERIAL.availableForWrite() > 0) {
+    if(!drainLeft)
+      drainLeft = recordSize(tail);
+    ACSI_SERIAL.write(ring[tail]);
+    tail = (tail + 1) % ringSize;
+    --drainLeft;
+    sent = true;
+  }
+  return sent;
+}
+
+int Trace::read(uint8_t *bytes, int count) {
+  stReader = true;
+
+  // Drop the end of a record partially sent on the serial port
+  tail = (tail + drainLeft) % ringSize;
+  drainLeft = 0;
+
+  int i = 0;
+  while(head != tail) {
+    int size = recordSize(tail);
+    if(i + size > count)
+      break;
+    for(int b = 0; b < size; ++b) {
+      bytes[i++] = ring[tail];
+      tail = (tail + 1) % ringSize;
+    }
+  }
+  return i;
+}
+
+void Trace::event(uint8_t id, uint32_t arg) {
+  uint8_t data[5];
+  data[0] = id;
+  ToLong(arg).set(&data[1]);
+  record(EVENT, data, sizeof(data));
+}
+
+void Trace::gemdos(uint16_t op, const void *params, int size) {
+  sysHookCommands = 0;
+
+  uint8_t data[2] = {
+    (uint8_t)(op >> 8),
+    (uint8_t)op
+  };
+  record(GEMDOS, data, sizeof(data), params, size);
+}
+
+void Trace::gemdosRte(uint32_t value) {
+  uint8_t data[6];
+  ToLong(value).set(data);
+  data[4] = sysHookCommands >> 8;
+  data[5] = sysHookCommands;
+  record(GEMDOS_RTE, data, sizeof(data));
+}
+
+void Trace::gemdosForward() {
+  uint8_t data[2] = {
+    (uint8_t)(sysHookCommands >> 8),
+    (uint8_t)sysHookCommands
+  };
+  record(GEMDOS_FORWARD, data, sizeof(data));
+}
+
+void Trace::acsi(uint8_t slot, uint32_t status, uint32_t duration,
+                 const uint8_t *cdb, int cdbLen) {
+  uint8_t data[8];
+  data[0] = slot;
+  data[1] = status >> 16;
+  data[2] = status >> 8;
+  data[3] = status;
+  ToLong(duration).set(&data[4]);
+  record(ACSI, data, sizeof(data), cdb, cdbLen);
+}
+
+int Trace::room() {
+  return (tail - head - 1 + ringSize) % ringSize;
+}
+
+int Trace::recordSize(int pos) {
+  return 6 + ring[(pos + 1) % ringSize];
+}
+
+void Trace::push(uint8_t byte) {
+  ring[head] = byte;
+  head = (head + 1) % ringSize;
+}
+
+void Trace::pushHeader(uint8_t type, int length) {
+  uint32_t now = Monitor::cycles();
+  push(type);
+  push(length);
+  push(now >> 24);
+  push(now >> 16);
+  push(now >> 8);
+  push(now);
+}
+
+uint8_t Trace::ring[Trace::ringSize];
+int Trace::head;
+int Trace::tail;
+int Trace::drainLeft = 0;
+bool Trace::stReader = false;
+uint16_t Trace::dropped;
+uint16_t Trace::sysHookCommands;
+
+#endif
+
+// vim: ts=2 sw=2 sts=2 et
@@ -0,0 +1,140 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "acsi2stm.h"
+#include "Idle.h"
+#include "Monitor.h"
+
+// Binary activity trace.
+//
+// Records GemDrive calls, ACSI commands and other events.
+// Records are appended to a RAM ring buffer of ACSI_TRACE bytes. They are sent
+// over the serial port when the bus is idle, until the ST reads them with the
+// "ACSITrcRd" vendor command. From then on, the ST is the only reader.
+//
+// Record format:
+//  * Type (1 byte)
+//  * Payload length (1 byte)
+//  * Timestamp in CPU cycles (Long)
+//  * Payload
+//
+// All multi-byte values are big endian.
+// If the ring buffer is full, new records are dropped and counted. The count
+// is sent in a DROPPED record as soon as there is room again.
+struct Trace {
+  enum Type {
+    DROPPED = 0x00, // Word: number of records dropped
+    GEMDOS = 0x01, // Word: opcode, then parameters as sent by the ST
+    GEMDOS_RTE = 0x02, // Long: return value, Word: SysHook commands
+    GEMDOS_FORWARD = 0x03, // Word: SysHook commands
+    ACSI = 0x04, // Byte: SD slot, 3 bytes: SCSI status (ASCQ, ASC, key),
+                 // Long: duration in CPU cycles, then CDB
+    EVENT = 0x05, // Byte: event id, Long: argument
+  };
+
+  // Event ids for EVENT records
+  enum Event {
+    EVENT_BUS_READY = 0x01, // Argument: 0
+    EVENT_QUICK_RESET = 0x02, // Argument: timeout timer value
+  };
+
+  // Setup the serial port and the cycle counter for trace output
+  static void begin() {
+#if ACSI_TRACE
+    ACSI_SERIAL.begin(ACSI_SERIAL_SPEED);
+    Monitor::beginCycles();
+    Idle::add(drain, Idle::HIGH);
+#endif
+  }
+
+#if ACSI_TRACE
+  // Append a record to the ring buffer.
+  // The payload is data followed by extra.
+  static void record(uint8_t type, const void *data, int size,
+                     const void *extra = nullptr, int extraSize = 0);
+
+  // Send as much trace data as possible without blocking.
+  // Returns true if some data was sent.
+  static bool drain();
+
+  // Remove whole records from the ring buffer, up to count bytes.
+  // Stops the serial output. Returns the number of bytes actually read.
+  static int read(uint8_t *bytes, int count);
+
+  // Record an event
+  static void event(uint8_t id, uint32_t arg = 0);
+
+  // Record a GEMDOS call
+  static void gemdos(uint16_t op, const void *params, int size);
+
+  // Record a GEMDOS call return value
+  static void gemdosRte(uint32_t value);
+
+  // Record a GEMDOS call forwarded to TOS
+  static void gemdosForward();
+
+  // Record a processed ACSI command
+  static void acsi(uint8_t slot, uint32_t status, uint32_t duration,
+                   const uint8_t *cdb, int cdbLen);
+
+  // Count a SysHook command sent to the ST
+  static void sysHookCommand() {
+    ++sysHookCommands;
+  }
+
+  static const int ringSize = ACSI_TRACE;
+  static uint8_t ring[ringSize];
+  static int head; // Write position
+  static int tail; // Read position
+  static int drainLeft; // Bytes of the record being sent on the serial port
+  static bool stReader; // Set once the ST has read the trace
+  static uint16_t dropped;
+  static uint16_t sysHookCommands; // Since the last GEMDOS call
+
+  // Return the number of free bytes in the ring buffer
+  static int room();
+
+  // Return the size of the record starting at a ring buffer position
+  static int recordSize(int pos);
+
+  // Append one byte to the ring buffer
+  static void push(uint8_t byte);
+
+  // Append a record header to the ring buffer
+  static void pushHeader(uint8_t type, int length);
+#else
+  static void record(uint8_t, const void *, int, const void * = nullptr, int = 0) {}
+  static bool drain() {
+    return false;
+  }
+  static int read(uint8_t *, int) {
+    return 0;
+  }
+  static void event(uint8_t, uint32_t = 0) {}
+  static void gemdos(uint16_t, const void *, int) {}
+  static void gemdosRte(uint32_t) {}
+  static void gemdosForward() {}
+  static void acsi(uint8_t, uint32_t, uint32_t, const uint8_t *, int) {}
+  static void sysHookCommand() {}
+#endif
+};
+
+// vim: ts=2 sw=2 sts=2 et
+#endif
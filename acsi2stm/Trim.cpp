@@ -0,0 +1,182 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// FAT internals are needed to walk cluster chains, see TinyFile.cpp.
+// If the library changes too much, it's not guaranteed to work anymore.
+#define private public
+#include <SdFat.h>
+#undef private
+
+#include "Trim.h"
+#include "BlockDev.h"
+
+#if ACSI_SD_TRIM && ! ACSI_STRICT
+// Send the erase commands like SdSpiCard::erase, without waiting for the card
+// to finish. SDHC/SDXC cards use sector addresses and always support erasing
+// single sectors, so the CSD checks of SdSpiCard::erase are not needed.
+static bool startErase(SdSpiCard &card, uint32_t first, uint32_t last) {
+  bool ok = !card.cardCommand(CMD32, first)
+         && !card.cardCommand(CMD33, last)
+         && !card.cardCommand(CMD38, 0);
+  card.spiStop();
+  return ok;
+}
+
+void Trim::queue(SdDev &sd, FsBaseFile &file) {
+  FatFile *fatFile = file.m_fFile;
+  uint8_t fatType = sd.fs.fatType();
+  if(!fatFile || (fatType != FAT_TYPE_FAT16 && fatType != FAT_TYPE_FAT32)
+      || sd.card.type() != SD_CARD_TYPE_SDHC)
+    return;
+
+  uint32_t cluster = fatFile->m_firstCluster;
+  if(!cluster)
+    // Empty file
+    return;
+
+  if(file.isContiguous()) {
+    add(sd, cluster, sd.sizeToClusters(file.fileSize()));
+    return;
+  }
+
+  // Split the chain into runs of consecutive clusters
+  FatVolume *vol = sd.fs.m_fVol;
+  uint32_t first = cluster;
+  uint32_t count = 1;
+  for(;;) {
+    uint32_t next;
+    int8_t status = vol->fatGet(cluster, &next);
+    if(status < 0)
+      return;
+
+    if(status && next == cluster + 1) {
+      ++count;
+      cluster = next;
+      continue;
+    }
+
+    if(!add(sd, first, count) || !status)
+      // Queue full or end of chain
+      return;
+
+    first = cluster = next;
+    count = 1;
+  }
+}
+
+void Trim::clear(SdDev *sd) {
+  int kept = 0;
+  for(int i = 0; i < rangeCount; ++i)
+    if(ranges[i].sd != sd)
+      ranges[kept++] = ranges[i];
+  rangeCount = kept;
+  if(erasing == sd)
+    erasing = nullptr;
+}
+
+bool Trim::busy(SdDev *sd) {
+  if(!erasing || (sd && erasing != sd))
+    return false;
+
+  if(erasing->card.isBusy())
+    return true;
+
+  erasing = nullptr;
+  return false;
+}
+
+bool Trim::run() {
+  if(!rangeCount || busy())
+    return false;
+
+  Range &range = ranges[0];
+  SdDev &sd = *range.sd;
+  if(sd.mode != SdDev::GEMDRIVE) {
+    clear(&sd);
+    return true;
+  }
+
+  // The clusters may have been allocated again since they were queued:
+  // only erase clusters that are still free.
+  FatVolume *vol = sd.fs.m_fVol;
+  uint32_t sectors = sd.fs.sectorsPerCluster();
+  uint32_t sliceClusters = sectors < sliceSectors ? sliceSectors / sectors : 1;
+  uint32_t count = 0;
+  while(count < range.count && count < sliceClusters) {
+    uint32_t value;
+    if(vol->fatGet(range.cluster + count, &value) != 1 || value)
+      break;
+    ++count;
+  }
+
+  uint32_t skip = count;
+  if(count) {
+    uint32_t first = sd.fs.dataStartSector() + (range.cluster - 2) * sectors;
+    if(!startErase(sd.card, first, first + count * sectors - 1)) {
+      // The card may not support erasing these sectors
+      pop();
+      return true;
+    }
+    erasing = &sd;
+  } else {
+    // Skip the cluster in use
+    skip = 1;
+  }
+
+  range.cluster += skip;
+  range.count -= skip;
+  if(!range.count)
+    pop();
+
+  return true;
+}
+
+bool Trim::add(SdDev &sd, uint32_t cluster, uint32_t count) {
+  if(!count)
+    return true;
+
+  if(rangeCount) {
+    // Merge with the last range if possible
+    Range &last = ranges[rangeCount - 1];
+    if(last.sd == &sd && last.cluster + last.count == cluster) {
+      last.count += count;
+      return true;
+    }
+  }
+
+  if(rangeCount >= ACSI_SD_TRIM)
+    return false;
+
+  Range &range = ranges[rangeCount++];
+  range.sd = &sd;
+  range.cluster = cluster;
+  range.count = count;
+  return true;
+}
+
+void Trim::pop() {
+  --rangeCount;
+  for(int i = 0; i < rangeCount; ++i)
+    ranges[i] = ranges[i + 1];
+}
+
+Trim::Range Trim::ranges[ACSI_SD_TRIM];
+int Trim::rangeCount = 0;
+SdDev *Trim::erasing = nullptr;
+#endif
+
+// vim: ts=2 sw=2 sts=2 et
@@ -0,0 +1,81 @@
+/* ACSI2STM Atari hard drive emulator
+ * Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with the program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TRIM_H
+#define TRIM_H
+
+#include "acsi2stm.h"
+#include "Devices.h"
+
+#include <SdFat.h>
+
+// Background erase of clusters freed by GemDrive.
+//
+// SD cards don't know which blocks are used by the file system, so deleted
+// files keep wearing the card and slowing down writes. GemDrive queues the
+// clusters of files it is about to delete or truncate. They are erased one
+// slice at a time while the bus is idle, after checking in the FAT that they
+// are still free.
+//
+// The queue holds ACSI_SD_TRIM cluster ranges. Ranges that don't fit are
+// simply not erased.
+//
+// Erase commands are sent without waiting for the card. While the card is
+// busy, idle tasks leave it alone, and commands wait for it in SdFat as they
+// would after a write. Only SDHC and SDXC cards are trimmed.
+struct Trim {
+#if ACSI_SD_TRIM && ! ACSI_STRICT
+  // Queue the clusters of a file or folder that is about to be freed
+  static void queue(SdDev &sd, FsBaseFile &file);
+
+  // Drop all ranges queued for a device
+  static void clear(SdDev *sd);
+
+  // Check if a card (any card if sd is null) is still erasing
+  static bool busy(SdDev *sd = nullptr);
+
+  // Idle task: start erasing one slice of the first queued range
+  static bool run();
+
+protected:
+  // Maximum number of sectors erased by run. At least one cluster is erased.
+  static const uint32_t sliceSectors = 128;
+
+  // Append a range to the queue. Returns false if the queue is full.
+  static bool add(SdDev &sd, uint32_t cluster, uint32_t count);
+
+  // Remove the first range from the queue
+  static void pop();
+
+  struct Range {
+    SdDev *sd;
+    uint32_t cluster;
+    uint32_t count;
+  };
+
+  static Range ranges[ACSI_SD_TRIM];
+  static int rangeCount;
+  static SdDev *erasing; // Card that may still be erasing
+#else
+  static void queue(SdDev &, FsBaseFile &) {}
+  static void clear(SdDev *) {}
+  static bool busy(SdDev * = nullptr) { return false; }
+#endif
+};
+
+// vim: ts=2 sw=2 sts=2 et
+#endif
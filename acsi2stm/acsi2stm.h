@@ -30,6 +30,22 @@
 // Set to 1 to enable verbose command output on the serial port
 #define ACSI_VERBOSE 0
 
+// Size in bytes of the binary trace ring buffer. Set to 0 to disable.
+// Records GemDrive calls and ACSI commands and sends them on the serial port
+// when the bus is idle. Format is described in Trace.h.
+// Cannot be used together with ACSI_DEBUG.
+#define ACSI_TRACE 0
+
+// Set to 1 to measure time spent in main code paths using the CPU cycle
+// counter. Statistics are read with the "ACSIPrfRd" vendor command and
+// printed on the serial port in debug mode. See Profile.h.
+#define ACSI_PROFILE 0
+
+// Set to 1 to count calls, DMA bytes, SD blocks and time spent for each ACSI
+// and GEMDOS opcode. Counters are read with the "ACSICntRd" vendor command and
+// displayed live by ACSISTAT.TOS. See Counters.h.
+#define ACSI_COUNTERS 0
+
 // Number of bytes per DMA transfer to dump in verbose mode
 // Set to 0 to disable data dump
 #define ACSI_DUMP_LEN 48
@@ -38,6 +54,17 @@
 #define ACSI_SERIAL Serial
 #define ACSI_SERIAL_SPEED 1000000
 
+// Size in bytes of the debug output ring buffer. Set to 0 to disable.
+// Debug output is written to RAM and sent to the serial port by DMA in the
+// background instead of waiting for the UART after each print.
+// Only works if ACSI_SERIAL is USART1 (Serial on the generic STM32F103C).
+#define ACSI_SERIAL_DMA 2048
+
+// Debug output ring buffer overflow policy.
+// Set to 0 to drop output and print the number of lost bytes.
+// Set to 1 to wait until the serial port has sent enough data.
+#define ACSI_SERIAL_DMA_BLOCK 0
+
 // Number of SD cards (1 to 5)
 #define ACSI_SD_CARDS 5
 
@@ -52,6 +79,12 @@
 // Falls back to mode 1 if strict mode is enabled.
 #define ACSI_READONLY 0
 
+// LUN used as a synthetic device for benchmarking. Set to 0 to disable.
+// Reads on this LUN return zeroes and writes are discarded without accessing
+// the SD card, so ACSITEST can measure raw bus throughput. ACSITEST uses LUN 7.
+// INQUIRY still reports this LUN as unsupported so drivers won't use it.
+#define ACSI_NULL_LUN 0
+
 // Set this to limit SD capacity artificially in ACSI mode.
 // Does not apply to disk images.
 //#define ACSI_MAX_BLOCKS 0x0FFFFF // 512MB limit
@@ -73,6 +106,15 @@
 // If set to 2: the pin is tied to GND when read-write, floating when read-only
 #define ACSI_SD_WRITE_LOCK 2
 
+// Number of freed cluster ranges GemDrive queues for erase. Freed clusters are
+// erased on the SD card while the bus is idle, which keeps write speed up on
+// heavily used cards. Disabled (0) by default. 8 is a good value to enable it.
+#define ACSI_SD_TRIM 0
+
+// If set to 1, the FORMAT UNIT command in ACSI mode erases the whole card or
+// image. Disabled by default: a stray format wipes all data.
+#define ACSI_FORMAT_UNIT 0
+
 // Data buffer size in 512 bytes blocks
 #define ACSI_BLOCKS 8
 
@@ -114,8 +156,18 @@
 //
 // Algorithms apply to STM32->ST transfers, for ST->STM32 any non-zero value
 // will enable fast DMA.
+//
+// Value 6 drives DRQ/ACK cycles entirely in hardware: each ACK triggers a
+// fixed length timer cycle and the STM32 DMA engine feeds the data bus. The CPU
+// is free during transfers, which allows reading the SD card at the same time.
 #define ACSI_FAST_DMA 5
 
+// Length of a DRQ/ACK cycle in 72MHz ticks when ACSI_FAST_DMA is 6.
+// The cycle starts when ACK goes low. Data is held on the bus and DRQ stays
+// high until the end of the cycle, then the next byte is requested.
+// Increase this value if DMA transfers are unreliable.
+#define ACSI_HW_DMA_CYCLE 24
+
 // Adds an additional delay between the last command byte received and the
 // beginning of a DMA transfer. There is an inherent write hole in the ST and
 // if unlucky enough a bus lock can happen, delaying the time between the CPU
@@ -201,11 +253,17 @@
 // smaller means less memory used by Pexec on the STM32.
 #define ACSI_GEMDRIVE_RELTABLE_CACHE_SIZE 512
 
+// Number of FAT sectors cached in RAM for GemDrive seeks. Each sector consumes
+// 512 bytes of static RAM. Speeds up random access in fragmented files.
+// Set to 0 to let SdFat walk cluster chains with its single sector cache.
+#define ACSI_GEMDRIVE_FAT_CACHE 4
+
 // Maximum number of files that can be opened at the same time. Consumes static
 // RAM on the STM32. Maximum is 256.
 #define ACSI_GEMDRIVE_MAX_FILES 64
 
-// Maximum depth of a path, in folders. Impacts RAM usage on the STM32.
+// Maximum depth of a path, in folders. Impacts RAM usage on the STM32: each
+// level takes 6 bytes in every path, including copies on the stack.
 #define ACSI_GEMDRIVE_MAX_PATH 64
 
 // Disable direct DMA access in GemDrive (used for testing/debug)
@@ -219,5 +277,12 @@
 // Performance will be horrible, but still better than floppy disks.
 #define ACSI_PIO 0
 
+// Use the STM32 DMA engine to stream bytes in PIO mode.
+// Bytes are fed to (or captured from) the data bus directly on CS edges, which
+// frees the CPU from polling each CS pulse and shortens the gap between bytes.
+// Set to 0 to use the CPU polling loop instead.
+// Only applies if ACSI_PIO is enabled.
+#define ACSI_PIO_STREAM 1
+
 // vim: ts=2 sw=2 sts=2 et
 #endif
@@ -25,6 +25,10 @@
 #error Cannot implement ACSI protocol in PIO mode
 #endif
 
+#if ACSI_TRACE && ACSI_DEBUG
+#error Binary trace and debug output cannot share the serial port
+#endif
+
 // Use a class to run initialization before constructing other globals
 struct PreBoot {
   PreBoot() {
@@ -43,14 +47,22 @@ struct PreBoot {
 PreBoot preBoot;
 
 #include "Acsi.h"
+#include "Counters.h"
 #include "Devices.h"
 #include "DmaPort.h"
 #include "GemDrive.h"
+#include "Profile.h"
+#include "Trace.h"
 
 void setup() {
     // Delay to let signals stabilize
     delay(5);
 
+    Trace::begin();
+    Profile::begin();
+    Counters::begin();
+    Devices::begin();
+
 #if ACSI_DEBUG
     Monitor::beginDbg();
 
@@ -104,7 +116,9 @@ void loop() {
 #endif
 
     Monitor::ledOff();
+    Devices::processing = false;
     uint8_t cmd = DmaPort::waitCommand();
+    Devices::processing = true;
     Monitor::ledOn();
 
     // Parse command and device
@@ -0,0 +1,40 @@
+; ACSI2STM Atari hard drive emulator
+; Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+header	dc.b	$1b,'E','ACSI2STM performance counters v'
+	incbin	..\..\VERSION
+	dc.b	$0d,$0a
+	dc.b	'By Jean-Matthieu Coulon',$0d,$0a
+	dc.b	'https://github.com/retro16/acsi2stm',$0d,$0a
+	dc.b	'License: GPLv3',$0d,$0a
+	dc.b	$0d,$0a
+	dc.b	'Requires a firmware built with',$0d,$0a
+	dc.b	'ACSI_COUNTERS enabled.',$0d,$0a
+	dc.b	$0d,$0a
+	dc.b	'Please input the ACSI device (0-7):',$0d,$0a
+	dc.b	$1b,'e'
+	dc.b	0
+
+clrscr	dc.b	$1b,'E',$1b,'f',0
+home	dc.b	$1b,'H',0
+
+footer	dc.b	$1b,'J',$0d,$0a
+	dc.b	'R: reset counters, other keys: exit',0
+
+nsuprt	dc.b	$0d,$0a,7,'Device does not support counters',$0d,$0a
+	dc.b	0
+
+; vim: ff=dos ts=8 sw=8 sts=8 noet colorcolumn=8,41,81 ft=asm68k tw=80
@@ -0,0 +1,179 @@
+; ACSI2STM Atari hard drive emulator
+; Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+	include	tui.s
+	even
+	include	acsicmd.s
+	even
+
+main:
+	print	header                  ; Welcome screen. Ask for a device
+
+.devrq	gemdos	Cnecin,2                ; Read device id
+
+	cmp.b	#$1b,d0                 ; Exit if pressed Esc
+	beq	.exit                   ;
+
+	sub.b	#'0',d0                 ; Transform to id
+	and.w	#$00ff,d0               ;
+
+	cmp.w	#7,d0                   ; Check if it is a valid id
+	bhi	.devrq                  ; Not valid: try again
+
+	lsl.w	#5,d0                   ; Store to d7
+	move.w	d0,d7                   ;
+
+	print	clrscr                  ;
+
+.loop	moveq	#4,d0                   ; Read 4 blocks of counters
+	move.l	#buffer,d1              ;
+	lea	.rdcmd,a0               ;
+	bsr	acsicmd                 ;
+
+	tst.b	d0                      ; Check if supported
+	bne	.failed                 ;
+
+	print	home                    ; Redraw the whole screen
+	bsr	display                 ;
+	print	footer                  ;
+
+	move.l	hz200.w,d6              ; Refresh every second
+	add.l	#200,d6                 ;
+.wait	gemdos	Cconis,2                ; Check for a key
+	tst.l	d0                      ;
+	bne.b	.key                    ;
+	cmp.l	hz200.w,d6              ;
+	bhi.b	.wait                   ;
+	bra	.loop                   ;
+
+.key	gemdos	Cnecin,2                ; Read the key
+
+	cmp.b	#'a',d0                 ; Transform to upper case
+	blo.b	.ucase                  ;
+	add.b	#'A'-'a',d0             ;
+
+.ucase	cmp.b	#'R',d0                 ; Reset counters
+	bne.b	.exit                   ;
+
+	moveq	#0,d0                   ; No data
+	lea	.rscmd,a0               ;
+	bsr	acsicmd                 ;
+
+	print	clrscr                  ;
+	bra	.loop                   ;
+
+.exit	rts
+
+.failed	print	nsuprt                  ; Print error
+	gemdos	Cnecin,2                ; Wait for a key
+	rts	                        ;
+
+.rdcmd	dc.b	8                       ; Read counters
+	dc.b	$1f,$20                 ;
+	dc.b	'ACSICntRd'             ;
+
+.rscmd	dc.b	8                       ; Reset counters
+	dc.b	$1f,$20                 ;
+	dc.b	'ACSICntRs'             ;
+
+	even
+
+display:
+	; Display counters from the buffer
+
+	print	.dmasnt                 ; Global counters
+	move.l	buffer,d0               ;
+	bsr	puint                   ;
+	print	.dmard                  ;
+	move.l	buffer+4,d0             ;
+	bsr	puint                   ;
+	print	.sdrd                   ;
+	move.l	buffer+8,d0             ;
+	bsr	puint                   ;
+	print	.sdwr                   ;
+	move.l	buffer+12,d0            ;
+	bsr	puint                   ;
+	print	.syshk                  ;
+	move.l	buffer+16,d0            ;
+	bsr	puint                   ;
+	print	.fathit                 ;
+	move.l	buffer+20,d0            ;
+	bsr	puint                   ;
+	print	.fatmis                 ;
+	move.l	buffer+24,d0            ;
+	bsr	puint                   ;
+	crlf	                        ;
+
+	print	.acsi                   ; ACSI opcodes
+	lea	buffer+32,a3            ;
+	moveq	#$40-1,d3               ;
+	bsr.b	prtops                  ;
+
+	print	.gemdos                 ; GEMDOS opcodes
+	lea	buffer+800,a3           ;
+	moveq	#$60-1,d3               ;
+	bra.b	prtops                  ;
+
+.dmasnt	dc.b	'DMA bytes sent:     ',0
+.dmard	dc.b	$0d,$0a,'DMA bytes read:     ',0
+.sdrd	dc.b	$0d,$0a,'SD blocks read:     ',0
+.sdwr	dc.b	$0d,$0a,'SD blocks written:  ',0
+.syshk	dc.b	$0d,$0a,'SysHook round trips:',0
+.fathit	dc.b	$0d,$0a,'FAT cache hits:     ',0
+.fatmis	dc.b	$0d,$0a,'FAT cache misses:   ',0
+.acsi	dc.b	$0d,$0a,'ACSI     calls  total us    max us',$0d,$0a,0
+.gemdos	dc.b	'GEMDOS   calls  total us    max us',$0d,$0a,0
+
+	even
+
+prtops:
+	; Print opcode entries that were called at least once
+	; Input:
+	;  a3: First entry
+	;  d3.w: Number of entries - 1
+
+	moveq	#0,d4                   ; d4 = current opcode
+
+.next	tst.l	(a3)                    ; Skip unused opcodes
+	beq.b	.skip                   ;
+
+	pchar2	' ',' '                 ; Opcode
+	move.b	d4,d0                   ;
+	bsr	tui.phbyte              ;
+
+	move.l	(a3),d0                 ; Calls
+	bsr	puint                   ;
+	move.l	4(a3),d0                ; Total time
+	bsr	puint                   ;
+	move.l	8(a3),d0                ; Max time
+	bsr	puint                   ;
+	crlf	                        ;
+
+.skip	lea	12(a3),a3               ; Next entry
+	addq.w	#1,d4                   ;
+	dbra	d3,.next                ;
+
+	rts
+
+puint:
+	; Print a 10 digits number, filled with spaces
+	; Input:
+	;  d0.l: Number to print
+
+	move.l	#$0001000a,d1           ;
+	bra	tui.puint               ;
+
+; vim: ff=dos ts=8 sw=8 sts=8 noet colorcolumn=8,41,81 ft=asm68k tw=80
@@ -0,0 +1,123 @@
+; ACSI2STM Atari hard drive emulator
+; Copyright (C) 2019-2025 by Jean-Matthieu Coulon
+
+; This program is free software: you can redistribute it and/or modify
+; it under the terms of the GNU General Public License as published by
+; the Free Software Foundation, either version 3 of the License, or
+; (at your option) any later version.
+
+; This program is distributed in the hope that it will be useful,
+; but WITHOUT ANY WARRANTY; without even the implied warranty of
+; MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+; GNU General Public License for more details.
+
+; You should have received a copy of the GNU General Public License
+; along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+; Measure DMA throughput with and without SD card access.
+; Reads on the ACSI2STM synthetic LUN 7 give raw bus throughput, reads on LUN 0
+; add SD card access time.
+
+benchmk:
+	print	.desc
+
+	lea	.sizes,a3               ; a3 = list of block counts
+
+.size	moveq	#0,d3                   ; d3 = current block count
+	move.b	(a3)+,d3                ;
+	beq	.exit                   ; End of list
+	move.b	d3,benchmk.read6.cnt    ;
+
+	move.l	d3,d0                   ; Print block count
+	move.l	#$00010006,d1           ;
+	bsr	tui.puint               ;
+
+	move.b	#$e0,benchmk.read6.lun  ; Bus throughput on the synthetic LUN
+	bsr	.run                    ;
+	lea	.nsuprt,a5              ;
+	tst.l	d0                      ;
+	bmi	.failed                 ;
+	bsr	.prtkbs                 ;
+
+	clr.b	benchmk.read6.lun       ; SD card throughput on LUN 0
+	bsr	.run                    ;
+	lea	.sdfail,a5              ;
+	tst.l	d0                      ;
+	bmi	.failed                 ;
+	bsr	.prtkbs                 ;
+	crlf	                        ;
+
+	gemdos	Cconis,2                ; Exit if a key was pressed
+	tst.l	d0                      ;
+	bne	.exit                   ;
+
+	bra	.size                   ;
+
+.run	; Read blocks repeatedly for one second
+	; Output:
+	;  d0.l: number of blocks read, -1 if failed
+	;  d5.l: number of 200Hz ticks actually elapsed
+
+	moveq	#0,d4                   ; d4 = blocks read
+
+	move.l	hz200.w,d5              ; Wait for the next tick
+.sync	cmp.l	hz200.w,d5              ;
+	beq.b	.sync                   ;
+	move.l	hz200.w,d6              ; d6 = start time
+
+.read	move.w	d3,d0                   ; Read d3 blocks
+	move.l	#buffer,d1              ;
+	lea	benchmk.read6,a0        ;
+	bsr	acsicmd                 ;
+
+	tst.b	d0                      ; Check for errors
+	bne.b	.rfail                  ;
+
+	add.l	d3,d4                   ; Count blocks
+
+	move.l	hz200.w,d5              ; Loop for 200 ticks
+	sub.l	d6,d5                   ;
+	cmp.l	#200,d5                 ;
+	blo.b	.read                   ;
+
+	move.l	d4,d0                   ;
+	rts	                        ;
+
+.rfail	moveq	#-1,d0                  ;
+	rts	                        ;
+
+.prtkbs	; Print throughput in KB/s
+	; Input:
+	;  d0.l: number of blocks read
+	;  d5.l: number of 200Hz ticks
+
+	mulu	#100,d0                 ; KB/s = blocks * 512 / 1024 * 200 / ticks
+	divu	d5,d0                   ;
+	and.l	#$0000ffff,d0           ;
+	move.l	#$0001000b,d1           ;
+	bra	tui.puint               ;
+
+.exit	gemdos	Cnecin,2                ; Flush keyboard buffer / wait for a key
+	crlf	                        ;
+	rts	                        ;
+
+.failed	crlf	                        ;
+	print	(a5)                    ; Print error
+	bra	.exit                   ; Wait for a key and exit
+
+.desc	dc.b	'Throughput benchmark. Press any key to exit.',$0d,$0a
+	dc.b	$0a
+	dc.b	'Blocks   Bus KB/s    SD KB/s',$0d,$0a
+	dc.b	0
+
+.nsuprt	dc.b	'Device has no synthetic LUN 7.',$0d,$0a
+	dc.b	0
+
+.sdfail	dc.b	'Cannot read the SD card.',$0d,$0a
+	dc.b	0
+
+.sizes	dc.b	1,2,4,8,16,32,64,128,255,0
+
+	even
+
+; vim: ff=dos ts=8 sw=8 sts=8 noet colorcolumn=8,41,81 ft=asm68k tw=80
@@ -25,7 +25,7 @@ failed	ds.w	1                       ; Failed tests
 blocks	ds.l	1                       ; Block count
 
 ; Buffer
-buffer	ds.b	65536+4                 ; Big buffer for file operations
+buffer	ds.b	255*512+16              ; Big buffer for file operations
 
 ; Request sense buffer
 sensbuf	ds.b	256                     ; Used by acsicmd.full
@@ -72,4 +72,15 @@ surftest.write10.blk
 	dc.b	$00,$01
 	dc.b	$00
 
+	even
+	ds.b	1                       ; Align block address
+benchmk.read6
+	dc.b	3
+	dc.b	$08
+benchmk.read6.lun
+	dc.b	$00,$00,$00             ; LUN and block 0
+benchmk.read6.cnt
+	dc.b	$01                     ; Block count
+	dc.b	$00
+
 ; vim: ff=dos ts=8 sw=8 sts=8 noet colorcolumn=8,41,81 ft=asm68k tw=80
@@ -42,6 +42,8 @@
 	even
 	include	cmdtest.s
 	even
+	include	benchmk.s
+	even
 
 main:
 	move.l	sp,mainsp               ; Used for abort
@@ -115,7 +117,12 @@ main:
 	bsr	cmdtest                 ;
 	bra	main                    ;
 
-.ncmdt	cmp.b	#'T',d0                 ; Go back to the beginning
+.ncmdt	cmp.b	#'P',d0                 ; Throughput benchmark
+	bne.b	.nbench                 ;
+	bsr	benchmk                 ;
+	bra	main                    ;
+
+.nbench	cmp.b	#'T',d0                 ; Go back to the beginning
 	beq	main                    ;
 
 .exit	rts
@@ -140,6 +147,7 @@ main:
 	dc.b	$0d,$0a
 	dc.b	'Press B for buffer load test,',$0d,$0a
 	dc.b	'      C for command load test,',$0d,$0a
+	dc.b	'      P for throughput benchmark,',$0d,$0a
 	dc.b	'      S for surface scan test,',$0d,$0a
 	dc.b	'      T to restart basic test,',$0d,$0a
 	dc.b	'or any other key to exit.',$0d,$0a
@@ -207,6 +207,72 @@ syshook.piocpy:
 
 	move.w	#$008a,(a1)             ; Enable CS byte transfer
 
+	bclr	#31,d1                  ; Bit 31 set: the STM32 polls each byte
+	bne.b	syshook.pioslow         ; and needs the slower loop
+
+	move.b	d0,d2                   ; Keep command byte for the direction
+
+	moveq	#7,d0                   ; Compute the entry point in the
+	and.w	d1,d0                   ; unrolled loop: skip (-count & 7)
+	neg.w	d0                      ; steps of 4 bytes
+	and.w	#7,d0                   ;
+	add.w	d0,d0                   ;
+	add.w	d0,d0                   ;
+
+	addq.l	#7,d1                   ; d1 = number of 8 bytes blocks
+	lsr.l	#3,d1                   ;
+
+	btst	#0,d2                   ;
+	bne.b	.piord                  ;
+
+	moveq	#0,d2                   ; d2 = byte buffer
+	jmp	.wloop(pc,d0.w)         ; Enter the unrolled loop
+
+.wloop	move.b	(a2)+,d2                ; Do the transfer byte per byte
+	move.w	d2,(a0)                 ;
+	move.b	(a2)+,d2                ; unrolled 8 times
+	move.w	d2,(a0)                 ;
+	move.b	(a2)+,d2                ;
+	move.w	d2,(a0)                 ;
+	move.b	(a2)+,d2                ;
+	move.w	d2,(a0)                 ;
+	move.b	(a2)+,d2                ;
+	move.w	d2,(a0)                 ;
+	move.b	(a2)+,d2                ;
+	move.w	d2,(a0)                 ;
+	move.b	(a2)+,d2                ;
+	move.w	d2,(a0)                 ;
+	move.b	(a2)+,d2                ;
+	move.w	d2,(a0)                 ;
+	subq.l	#1,d1                   ;
+	bne.b	.wloop                  ;
+
+	bra.w	syshook.reply           ;
+
+.piord	jmp	.rloop(pc,d0.w)         ; Enter the unrolled loop
+
+.rloop	move.w	(a0),d2                 ; Do the transfer byte per byte
+	move.b	d2,(a2)+                ;
+	move.w	(a0),d2                 ; unrolled 8 times
+	move.b	d2,(a2)+                ;
+	move.w	(a0),d2                 ;
+	move.b	d2,(a2)+                ;
+	move.w	(a0),d2                 ;
+	move.b	d2,(a2)+                ;
+	move.w	(a0),d2                 ;
+	move.b	d2,(a2)+                ;
+	move.w	(a0),d2                 ;
+	move.b	d2,(a2)+                ;
+	move.w	(a0),d2                 ;
+	move.b	d2,(a2)+                ;
+	move.w	(a0),d2                 ;
+	move.b	d2,(a2)+                ;
+	subq.l	#1,d1                   ;
+	bne.b	.rloop                  ;
+
+	bra.w	syshook.reply           ;
+
+syshook.pioslow:
 	moveq	#0,d2                   ; d2 = byte buffer
 
 	btst	#0,d0                   ;
@@ -22,6 +22,7 @@ injectfiles() {
   mcopy -i "$img" README.TXT COPYRGHT.TXT ::
   mmd -i "$img" ::TOOLS
   mcopy -i "$img" tools/ACSITEST.TOS ::TOOLS
+  mcopy -i "$img" tools/ACSISTAT.TOS ::TOOLS
   mcopy -i "$img" tools/CHARGEN.TOS ::TOOLS
   mcopy -i "$img" tools/SWAPTEST.TOS ::TOOLS
   mcopy -i "$img" tools/TOSTEST.TOS ::TOOLS